@@ -0,0 +1,84 @@
+// Counts heap allocations per log line once the logger has warmed up (thread-local streams
+// constructed, async queue slots grown), for the synchronous and asynchronous modes.
+// Exits with a failure status if formatting a typical line still allocates.
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+#include <micro-logger/logger_factory.h>
+
+static std::atomic<uint64_t> allocations{0};
+
+// GCC flags free() on memory from operator new, not knowing operator new is replaced below
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(const std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+// Discards everything, without allocating
+class NullStreambuf : public std::streambuf {
+protected:
+  int_type overflow(const int_type c) override {
+    return traits_type::not_eof(c);
+  }
+
+  std::streamsize xsputn(const char*, const std::streamsize n) override {
+    return n;
+  }
+};
+
+// Lines keep the same length, so the async queue slots are fully grown after the warm-up
+static void logLines(const ulog::Logger& logger, const std::string& user, const int count) {
+  for (int i = 0; i < count; ++i) {
+    logger.info << "Request " << 100000 + i % 100000 << " from " << user << " took " << 12.5 + i % 10 << "ms";
+  }
+}
+
+static double allocationsPerLine(const size_t asyncQueueCapacity) {
+  constexpr int WARM_UP_LINES = 10'000;
+  constexpr int MEASURED_LINES = 100'000;
+
+  NullStreambuf streambuf;
+  std::ostream stream(&streambuf);
+  ulog::LoggerFactory loggerFactory(&stream, "bench", nullptr, false);
+  loggerFactory.asyncMode(asyncQueueCapacity);
+  const auto logger = loggerFactory.create("Allocations");
+  const std::string user = "someone@example.com";
+
+  logLines(logger, user, WARM_UP_LINES);
+  loggerFactory.flush();
+
+  const uint64_t before = allocations.load();
+  logLines(logger, user, MEASURED_LINES);
+  const uint64_t after = allocations.load();
+  loggerFactory.flush();
+
+  return static_cast<double>(after - before) / MEASURED_LINES;
+}
+
+int main() {
+  const double sync = allocationsPerLine(0);
+  const double async = allocationsPerLine(1024);
+
+  std::cout << "Heap allocations per line (sync):  " << sync << std::endl
+            << "Heap allocations per line (async): " << async << std::endl;
+  return sync == 0 && async == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
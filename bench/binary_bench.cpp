@@ -0,0 +1,122 @@
+// Compares text and binary mode (LoggerFactory::binaryMode): time per line on the logging thread
+// and bytes written per line, for a typical latency/ID-heavy line written with `<<` and with
+// `fmt<>`. Also checks that the binary `fmt<>` lines decode to the text ones.
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+
+#include <micro-logger/logger_factory.h>
+
+// Counts and discards what is written
+class CountingStreambuf : public std::streambuf {
+public:
+  uint64_t bytes = 0;
+
+protected:
+  int_type overflow(const int_type c) override {
+    ++bytes;
+    return traits_type::not_eof(c);
+  }
+
+  std::streamsize xsputn(const char*, const std::streamsize n) override {
+    bytes += static_cast<uint64_t>(n);
+    return n;
+  }
+};
+
+struct Result {
+  double nanosecondsPerLine;
+  double bytesPerLine;
+};
+
+template <typename Logger>
+static void logRequest(const Logger& logger, const bool useFmt, const int i) {
+  if (useFmt) {
+    logger.info.template fmt<"Request {} for user {} took {}ms ({} retries)">(1000000 + i, 42 * i, 12.5 + i % 100, i % 7);
+  } else {
+    logger.info << "Request " << 1000000 + i << " for user " << 42 * i << " took " << 12.5 + i % 100 << "ms (" << i % 7 << " retries)";
+  }
+}
+
+static Result run(const bool binary, const bool useFmt) {
+  constexpr int LINES = 1'000'000;
+
+  CountingStreambuf streambuf;
+  std::ostream stream(&streambuf);
+  ulog::LoggerFactory loggerFactory(&stream, "bench", nullptr, false);
+  loggerFactory.binaryMode(binary);
+  const auto logger = loggerFactory.create("BinaryBench");
+
+  const uint64_t bytesBefore = streambuf.bytes;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < LINES; ++i) {
+    logRequest(logger, useFmt, i);
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+
+  return {
+    std::chrono::duration<double, std::nano>(elapsed).count() / LINES,
+    static_cast<double>(streambuf.bytes - bytesBefore) / LINES
+  };
+}
+
+// The messages of a few lines, as written in text mode or decoded from binary mode
+static std::string messages(const bool binary) {
+  std::ostringstream stream;
+  {
+    ulog::LoggerFactory loggerFactory(&stream, "bench", nullptr, false);
+    loggerFactory.binaryMode(binary);
+    const auto logger = loggerFactory.create("BinaryBench");
+    for (int i = 0; i < 3; ++i) {
+      logRequest(logger, true, i);
+    }
+  }
+  std::string lines = stream.str();
+  if (binary) {
+    ulog::BinaryLogDecoder decoder;
+    std::string decoded;
+    if (!decoder.decode(lines, [&](const std::string_view line) { decoded += line; })) {
+      return "corrupted";
+    }
+    lines = decoded;
+  }
+  std::string result;
+  for (size_t start = 0; start < lines.size();) {
+    const size_t end = lines.find('\n', start);
+    const size_t message = lines.rfind(" | ", end);
+    result += lines.substr(message + 3, end + 1 - message - 3);
+    start = end + 1;
+  }
+  return result;
+}
+
+static void print(const char* name, const Result& result, const Result& text) {
+  std::cout << name << result.nanosecondsPerLine << " ns/line, " << result.bytesPerLine << " bytes/line ("
+            << text.nanosecondsPerLine / result.nanosecondsPerLine << "x faster, "
+            << text.bytesPerLine / result.bytesPerLine << "x smaller)" << std::endl;
+}
+
+int main() {
+  if (messages(true) != messages(false)) {
+    std::cerr << "Binary fmt<> lines decode to:\n" << messages(true) << "instead of:\n" << messages(false);
+    return 1;
+  }
+
+  const Result text = run(false, false);
+  const Result binary = run(true, false);
+  const Result textFmt = run(false, true);
+  const Result binaryFmt = run(true, true);
+
+  std::cout << std::fixed << std::setprecision(1)
+            << "Text, <<:     " << text.nanosecondsPerLine << " ns/line, " << text.bytesPerLine << " bytes/line" << std::endl;
+  print("Binary, <<:   ", binary, text);
+  std::cout << "Text, fmt:    " << textFmt.nanosecondsPerLine << " ns/line, " << textFmt.bytesPerLine << " bytes/line" << std::endl;
+  print("Binary, fmt:  ", binaryFmt, textFmt);
+  return 0;
+}
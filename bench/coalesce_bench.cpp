@@ -0,0 +1,69 @@
+// Measures what duplicate coalescing (LoggerFactory::coalesceDuplicates) costs on distinct lines,
+// which are all written, and what it saves on a storm of identical lines, which are only counted.
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+#include <micro-logger/logger_factory.h>
+
+// Discards what is written
+class NullStreambuf : public std::streambuf {
+protected:
+  int_type overflow(const int_type c) override {
+    return traits_type::not_eof(c);
+  }
+
+  std::streamsize xsputn(const char*, const std::streamsize n) override {
+    return n;
+  }
+};
+
+static constexpr int LINES = 2'000'000;
+static constexpr int ROUNDS = 3; // keeps the best
+
+template <typename F>
+static double nanosecondsPerLine(const bool coalesce, F&& log) {
+  double best = 0;
+  for (int round = 0; round < ROUNDS; ++round) {
+    NullStreambuf streambuf;
+    std::ostream output(&streambuf);
+    ulog::LoggerFactory loggerFactory(&output, "bench", nullptr, false, false);
+    if (coalesce) {
+      loggerFactory.coalesceDuplicates();
+    }
+    const auto logger = loggerFactory.create("CoalesceBench");
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < LINES; ++i) {
+      log(logger, i);
+    }
+    const double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    best = round == 0 ? elapsed : std::min(best, elapsed);
+  }
+  return best / LINES;
+}
+
+int main() {
+  const std::string user = "someone@example.com";
+  const auto distinct = [&](const ulog::Logger& logger, const int i) {
+    logger.info << "Request " << 100000 + i << " from " << user << " took " << 12.5 + i % 10 << "ms";
+  };
+  const auto identical = [&](const ulog::Logger& logger, int) {
+    logger.error << "Connection to " << user << " refused";
+  };
+
+  const double distinctPlain = nanosecondsPerLine(false, distinct);
+  const double distinctCoalesced = nanosecondsPerLine(true, distinct);
+  const double identicalPlain = nanosecondsPerLine(false, identical);
+  const double identicalCoalesced = nanosecondsPerLine(true, identical);
+
+  std::cout << std::fixed << std::setprecision(1)
+            << "Distinct lines:  " << distinctPlain << " ns/line, coalescing " << distinctCoalesced << " ns/line ("
+            << (distinctCoalesced - distinctPlain) / distinctPlain * 100 << "%)" << std::endl
+            << "Identical lines: " << identicalPlain << " ns/line, coalescing " << identicalCoalesced << " ns/line ("
+            << (identicalCoalesced - identicalPlain) / identicalPlain * 100 << "%)" << std::endl;
+  return 0;
+}
@@ -0,0 +1,51 @@
+// Compares formatting numbers into a LogBuffer through std::ostream (the generic operator<< path)
+// with the std::to_chars-based ValueFormatter used by LogMessageBuilder's fast overloads.
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+
+#include <micro-logger/log_buffer.h>
+#include <micro-logger/value_formatter.h>
+
+template <typename F>
+static double nanosecondsPerLine(const int iterations, F&& format) {
+  ulog::LogBuffer buffer;
+  size_t checksum = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    buffer.clear();
+    format(buffer, i);
+    checksum += buffer.size();
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  if (checksum == 0) {
+    std::cerr << "unexpected checksum" << std::endl;
+  }
+  return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+int main() {
+  constexpr int ITERATIONS = 2'000'000;
+
+  // A latency/ID-heavy line: request ID, user ID, two latencies and a ratio
+  const double stream = nanosecondsPerLine(ITERATIONS, [](ulog::LogBuffer& buffer, const int i) {
+    ulog::LogBufferStream::Target target(ulog::LogBufferStream::forThisThread(), buffer, true);
+    target.stream() << static_cast<uint64_t>(i) * 7919 << static_cast<int64_t>(-i)
+                    << 12.5 + i << static_cast<double>(i) / 3 << 0.25f * i;
+  });
+  const double toChars = nanosecondsPerLine(ITERATIONS, [](ulog::LogBuffer& buffer, const int i) {
+    ulog::ValueFormatter::appendInteger(buffer, static_cast<uint64_t>(i) * 7919);
+    ulog::ValueFormatter::appendInteger(buffer, static_cast<int64_t>(-i));
+    ulog::ValueFormatter::appendFloatingPoint(buffer, 12.5 + i);
+    ulog::ValueFormatter::appendFloatingPoint(buffer, static_cast<double>(i) / 3);
+    ulog::ValueFormatter::appendFloatingPoint(buffer, 0.25f * i);
+  });
+
+  std::cout << std::fixed << std::setprecision(1)
+            << "std::ostream insertion: " << stream << " ns/line" << std::endl
+            << "std::to_chars:          " << toChars << " ns/line (" << stream / toChars << "x)"
+            << std::endl;
+  return 0;
+}
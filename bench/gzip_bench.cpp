@@ -0,0 +1,97 @@
+// Writes lines through a GzipFileSink with small blocks and files, so that blocks are cut and files
+// rotated many times, then reads every file back with `gunzip -c` and checks that each line is
+// whole and that none is missing. Prints the time per line and the compression ratio.
+//
+// Links with zlib (-lz), and needs `gunzip` in the PATH.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <micro-logger/gzip_file_sink.h>
+#include <micro-logger/logger_factory.h>
+
+static constexpr int LINES = 300'000;
+static constexpr uint64_t MAX_FILE_SIZE = 256 * 1024;
+static constexpr int RETAINED_FILES = 1000; // none deleted
+static constexpr size_t BLOCK_SIZE = 16 * 1024;
+
+static const std::filesystem::path DIRECTORY = std::filesystem::temp_directory_path() / "ulog_gzip_bench";
+static const std::string PATH = (DIRECTORY / "app.log.gz").string();
+
+struct ReadBack {
+  long     lines = 0;
+  uint64_t bytes = 0; // uncompressed
+};
+
+// Reads back one file, checking that its lines are "... | Request <n> from ... done" with
+// consecutive n.
+static bool readBack(const std::string& path, ReadBack& result) {
+  FILE* pipe = ::popen(("gunzip -c '" + path + "'").c_str(), "r");
+  if (pipe == nullptr) {
+    return false;
+  }
+  bool valid = true;
+  char line[512];
+  while (std::fgets(line, sizeof(line), pipe) != nullptr) {
+    const std::string text(line);
+    const size_t position = text.find("| Request ");
+    if (position == std::string::npos || !text.ends_with(" done\n")
+        || std::atol(text.c_str() + position + 10) != result.lines) {
+      std::cerr << "Unexpected line in " << path << ": " << text << std::endl;
+      valid = false;
+      break;
+    }
+    ++result.lines;
+    result.bytes += text.size();
+  }
+  return ::pclose(pipe) == 0 && valid;
+}
+
+static std::string filePath(const int index) {
+  return index == 0 ? PATH : (DIRECTORY / ("app.log." + std::to_string(index) + ".gz")).string();
+}
+
+int main() {
+  std::filesystem::remove_all(DIRECTORY);
+  std::filesystem::create_directories(DIRECTORY);
+
+  double nanosecondsPerLine;
+  {
+    ulog::GzipFileSink sink(PATH, MAX_FILE_SIZE, RETAINED_FILES, Z_DEFAULT_COMPRESSION, BLOCK_SIZE);
+    ulog::LoggerFactory loggerFactory(&sink, "bench", nullptr, false, false);
+    const auto logger = loggerFactory.create("GzipBench");
+    const std::string user = "someone@example.com";
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < LINES; ++i) {
+      logger.info << "Request " << i << " from " << user << " took " << 12.5 + i % 10 << "ms, done";
+    }
+    nanosecondsPerLine = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / LINES;
+  } // the sink's destructor compresses and writes the remaining blocks
+
+  // Oldest first: app.log.<N>.gz ... app.log.1.gz, then app.log.gz
+  int rotatedFiles = 0;
+  while (std::filesystem::exists(filePath(rotatedFiles + 1))) {
+    ++rotatedFiles;
+  }
+  ReadBack result;
+  uint64_t compressedBytes = 0;
+  bool valid = true;
+  for (int index = rotatedFiles; index >= 0 && valid; --index) {
+    compressedBytes += std::filesystem::file_size(filePath(index));
+    valid = readBack(filePath(index), result);
+  }
+  valid = valid && result.lines == LINES;
+  std::filesystem::remove_all(DIRECTORY);
+
+  std::cout << std::fixed << std::setprecision(1)
+            << "GzipFileSink: " << nanosecondsPerLine << " ns/line, " << rotatedFiles + 1 << " files, "
+            << result.lines << "/" << LINES << " whole lines read back with gunzip, "
+            << static_cast<double>(result.bytes) / static_cast<double>(compressedBytes) << "x smaller" << std::endl;
+  return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,95 @@
+// Compares the text and JSON lines modes (LoggerFactory::jsonMode) for the same line, with and
+// without key-value fields, and the JsonFormatter's escaping with a byte-by-byte loop.
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+#include <micro-logger/logger_factory.h>
+
+// Discards what is written
+class NullStreambuf : public std::streambuf {
+protected:
+  int_type overflow(const int_type c) override {
+    return traits_type::not_eof(c);
+  }
+
+  std::streamsize xsputn(const char*, const std::streamsize n) override {
+    return n;
+  }
+};
+
+static constexpr int LINES = 1'000'000;
+
+template <typename F>
+static double nanosecondsPerLine(F&& log) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < LINES; ++i) {
+    log(i);
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / LINES;
+}
+
+struct Result {
+  double message;
+  double fields;
+};
+
+static Result run(const bool json) {
+  NullStreambuf streambuf;
+  std::ostream stream(&streambuf);
+  ulog::LoggerFactory loggerFactory(&stream, "bench", nullptr, false, false);
+  loggerFactory.jsonMode(json);
+  const auto logger = loggerFactory.create("JsonBench");
+  const std::string user = "someone@example.com";
+
+  return {
+    nanosecondsPerLine([&](const int i) {
+      logger.info << "Request " << 1000000 + i << " from " << user << " took " << 12.5 + i % 100 << "ms";
+    }),
+    nanosecondsPerLine([&](const int i) {
+      logger.info.kv("request", 1000000 + i).kv("user", user).kv("latency_ms", 12.5 + i % 100) << "Request done";
+    })
+  };
+}
+
+static void appendEscapedBytewise(ulog::LogBuffer& buffer, const std::string_view text) {
+  for (const char c : text) {
+    if (static_cast<unsigned char>(c) < 0x20 || c == '"' || c == '\\') {
+      buffer.append('\\');
+      buffer.append(c == '"' || c == '\\' ? c : 'u');
+    } else {
+      buffer.append(c);
+    }
+  }
+}
+
+template <typename F>
+static double nanosecondsPerMessage(const std::string& message, F&& escape) {
+  ulog::LogBuffer buffer;
+  return nanosecondsPerLine([&](int) {
+    buffer.clear();
+    escape(buffer, message);
+  });
+}
+
+int main() {
+  const Result text = run(false);
+  const Result json = run(true);
+
+  const std::string message = "GET /api/v1/users/12345/orders?page=2&limit=50 completed with status 200 in 12.5ms";
+  const double bytewise = nanosecondsPerMessage(message, appendEscapedBytewise);
+  const double escaped = nanosecondsPerMessage(message, ulog::JsonFormatter::appendEscaped);
+
+  std::cout << std::fixed << std::setprecision(1)
+            << "Text:           " << text.message << " ns/line, with fields " << text.fields << " ns/line" << std::endl
+            << "JSON:           " << json.message << " ns/line, with fields " << json.fields << " ns/line" << std::endl
+            << "Escaping (" << message.size() << " bytes): " << escaped << " ns, byte by byte " << bytewise
+            << " ns (" << bytewise / escaped << "x)" << std::endl;
+  return 0;
+}
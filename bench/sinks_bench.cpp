@@ -0,0 +1,84 @@
+// Compares writing every line to two outputs (colored text and plain text, then colored text and
+// JSON lines) with two factories, i.e. two loggers formatting each line, and with one factory and
+// a sink added with LoggerFactory::addSink, formatting each line once.
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+#include <micro-logger/logger_factory.h>
+
+// Discards what is written
+class NullStreambuf : public std::streambuf {
+protected:
+  int_type overflow(const int_type c) override {
+    return traits_type::not_eof(c);
+  }
+
+  std::streamsize xsputn(const char*, const std::streamsize n) override {
+    return n;
+  }
+};
+
+static constexpr int LINES = 1'000'000;
+
+template <typename F>
+static double nanosecondsPerLine(F&& log) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < LINES; ++i) {
+    log(i);
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / LINES;
+}
+
+static void logLine(const ulog::Logger& logger, const std::string& user, const int i) {
+  logger.info.kv("latency_ms", 12.5 + i % 100) << "Request " << 1000000 + i << " from " << user;
+}
+
+struct Result {
+  double twoFactories;
+  double addedSink;
+};
+
+static Result run(const bool json) {
+  NullStreambuf streambuf;
+  std::ostream console(&streambuf);
+  std::ostream file(&streambuf);
+  const std::string user = "someone@example.com";
+
+  ulog::LoggerFactory consoleFactory(&console, "bench");
+  ulog::LoggerFactory fileFactory(&file, "bench", nullptr, false, false);
+  fileFactory.jsonMode(json);
+  const auto consoleLogger = consoleFactory.create("SinksBench");
+  const auto fileLogger = fileFactory.create("SinksBench");
+
+  ulog::LoggerFactory loggerFactory(&console, "bench");
+  loggerFactory.addSink(&file, ulog::DEBUG, json ? ulog::JSON_LINES : ulog::PLAIN_TEXT);
+  const auto logger = loggerFactory.create("SinksBench");
+
+  return {
+    nanosecondsPerLine([&](const int i) {
+      logLine(consoleLogger, user, i);
+      logLine(fileLogger, user, i);
+    }),
+    nanosecondsPerLine([&](const int i) {
+      logLine(logger, user, i);
+    })
+  };
+}
+
+int main() {
+  const Result plain = run(false);
+  const Result json = run(true);
+
+  std::cout << std::fixed << std::setprecision(1)
+            << "Text + plain text: two factories " << plain.twoFactories << " ns/line, addSink " << plain.addedSink
+            << " ns/line (" << plain.twoFactories / plain.addedSink << "x)" << std::endl
+            << "Text + JSON lines: two factories " << json.twoFactories << " ns/line, addSink " << json.addedSink
+            << " ns/line (" << json.twoFactories / json.addedSink << "x)" << std::endl;
+  return 0;
+}
@@ -0,0 +1,223 @@
+// Measures the logging hot path (LogStream -> LogMessageBuilder -> LogWriter) for each combination
+// of the factory's settings: thread safety, thread buffering, alwaysFlush, ANSI escapes, and the
+// output (/dev/null, a file, a std::ostringstream, a file through FdSink). For each one, with 1..N logging threads (1 without thread safety):
+// throughput, per-call latency percentiles and heap allocations per line.
+//
+// Writes one CSV row per run to stdout, so results can be diffed between versions:
+//   ./throughput_bench [lines per thread] [max threads] > results.csv
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <micro-logger/fd_sink.h>
+#include <micro-logger/logger_factory.h>
+
+static std::atomic<uint64_t> allocations{0};
+
+// GCC flags free() on memory from operator new, not knowing operator new is replaced below
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(const std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+enum Output { DEV_NULL, FILE_OUTPUT, STRING_STREAM, FD_FILE };
+
+static const char* outputName(const Output output) {
+  switch (output) {
+    case DEV_NULL:      return "devnull";
+    case FILE_OUTPUT:   return "file";
+    case STRING_STREAM: return "ostringstream";
+    case FD_FILE:       return "fd_file";
+  }
+  return "unknown";
+}
+
+struct Config {
+  bool   threadSafe;
+  bool   threadBuffering;
+  bool   alwaysFlush;
+  bool   ansi;
+  Output output;
+};
+
+struct Result {
+  double linesPerSecond;
+  double p50Nanoseconds;
+  double p99Nanoseconds;
+  double p999Nanoseconds;
+  double allocationsPerLine;
+};
+
+static const std::filesystem::path FILE_PATH = std::filesystem::temp_directory_path() / "ulog_throughput_bench.log";
+
+static std::unique_ptr<std::ostream> openOutput(const Output output) {
+  switch (output) {
+    case DEV_NULL:      return std::make_unique<std::ofstream>("/dev/null");
+    case FILE_OUTPUT:   return std::make_unique<std::ofstream>(FILE_PATH, std::ios::out | std::ios::trunc);
+    case STRING_STREAM: return std::make_unique<std::ostringstream>();
+    case FD_FILE:       return nullptr;
+  }
+  return nullptr;
+}
+
+static std::unique_ptr<ulog::LogSink> openSink(const Output output, std::ostream* stream) {
+  if (output == FD_FILE) {
+    std::filesystem::remove(FILE_PATH);
+    return std::make_unique<ulog::FdSink>(FILE_PATH.string());
+  }
+  return std::make_unique<ulog::OstreamSink>(*stream);
+}
+
+// A latency/ID-heavy line, going through the integer, floating point and string fast paths
+static void logLine(const ulog::Logger& logger, const std::string& user, const int i) {
+  logger.info << "Request " << 100000 + i % 100000 << " from " << user << " took " << 12.5 + i % 10 << "ms";
+}
+
+static double percentile(std::vector<uint32_t>& samples, const double fraction) {
+  const auto index = static_cast<size_t>(fraction * static_cast<double>(samples.size() - 1));
+  std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(index), samples.end());
+  return samples[index];
+}
+
+static Result run(const Config& config, const int threadCount, const int linesPerThread) {
+  constexpr int WARM_UP_LINES = 1'000;
+
+  const auto output = openOutput(config.output);
+  const auto sink = openSink(config.output, output.get());
+  ulog::LoggerFactory loggerFactory(sink.get(), "bench", nullptr, config.alwaysFlush, config.ansi);
+  if (!config.threadSafe) {
+    loggerFactory.threadSafe(false);
+  }
+  if (config.threadBuffering) {
+    loggerFactory.threadBuffering(64 * 1024);
+  }
+  const std::string user = "someone@example.com";
+
+  std::vector<ulog::Logger> loggers;
+  std::vector<std::vector<uint32_t>> latencies(threadCount);
+  for (int thread = 0; thread < threadCount; ++thread) {
+    loggers.push_back(loggerFactory.create("Worker " + std::to_string(thread)));
+    latencies[thread].resize(linesPerThread);
+  }
+
+  std::atomic<int> ready{0};
+  std::atomic<bool> start{false};
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < threadCount; ++thread) {
+    threads.emplace_back([&, thread] {
+      const ulog::Logger& logger = loggers[thread];
+      uint32_t* samples = latencies[thread].data();
+      for (int i = 0; i < WARM_UP_LINES; ++i) {
+        logLine(logger, user, i);
+      }
+      ready.fetch_add(1);
+      while (!start.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      for (int i = 0; i < linesPerThread; ++i) {
+        const auto before = std::chrono::steady_clock::now();
+        logLine(logger, user, i);
+        samples[i] = static_cast<uint32_t>(std::min<int64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - before).count(),
+          UINT32_MAX
+        ));
+      }
+    });
+  }
+
+  while (ready.load() < threadCount) {
+    std::this_thread::yield();
+  }
+  const uint64_t allocationsBefore = allocations.load();
+  const auto startTime = std::chrono::steady_clock::now();
+  start.store(true, std::memory_order_release);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  loggerFactory.flush();
+  const auto elapsed = std::chrono::steady_clock::now() - startTime;
+  const uint64_t allocationsAfter = allocations.load();
+
+  std::vector<uint32_t> samples;
+  for (const auto& threadSamples : latencies) {
+    samples.insert(samples.end(), threadSamples.begin(), threadSamples.end());
+  }
+  const double lines = static_cast<double>(threadCount) * linesPerThread;
+  return {
+    lines / std::chrono::duration<double>(elapsed).count(),
+    percentile(samples, 0.5),
+    percentile(samples, 0.99),
+    percentile(samples, 0.999),
+    static_cast<double>(allocationsAfter - allocationsBefore) / lines
+  };
+}
+
+int main(int argc, char** argv) {
+  const int linesPerThread = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 50'000;
+  const int maxThreads = argc > 2
+    ? std::max(std::atoi(argv[2]), 1)
+    : static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+
+  std::vector<int> threadCounts;
+  for (int threads = 1; threads < maxThreads; threads *= 2) {
+    threadCounts.push_back(threads);
+  }
+  threadCounts.push_back(maxThreads);
+
+  std::printf("thread_safe,thread_buffering,always_flush,ansi,output,threads,lines_per_second,p50_ns,p99_ns,p999_ns,allocations_per_line\n");
+  for (const bool threadSafe : {true, false}) {
+    for (const bool threadBuffering : {false, true}) {
+      if (!threadSafe && threadBuffering) {
+        break; // only with thread safety
+      }
+      for (const bool alwaysFlush : {false, true}) {
+        for (const bool ansi : {false, true}) {
+          for (const Output output : {DEV_NULL, FILE_OUTPUT, STRING_STREAM, FD_FILE}) {
+            const Config config{threadSafe, threadBuffering, alwaysFlush, ansi, output};
+            for (const int threads : threadCounts) {
+              if (!threadSafe && threads > 1) {
+                break;
+              }
+              const Result result = run(config, threads, linesPerThread);
+              std::printf(
+                "%d,%d,%d,%d,%s,%d,%.0f,%.0f,%.0f,%.0f,%.3f\n",
+                threadSafe, threadBuffering, alwaysFlush, ansi, outputName(output), threads,
+                result.linesPerSecond, result.p50Nanoseconds, result.p99Nanoseconds, result.p999Nanoseconds,
+                result.allocationsPerLine
+              );
+              std::fflush(stdout);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  std::filesystem::remove(FILE_PATH);
+  return 0;
+}
@@ -0,0 +1,131 @@
+// Compares the per-second cached timestamp formatting (TimestampCache) with the previous
+// implementation, which called localtime_r + std::put_time into a new std::stringstream every time,
+// and the cost of taking a timestamp from std::chrono::system_clock and from a TscClock.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <micro-logger/log_clock.h>
+#include <micro-logger/timestamp_cache.h>
+
+using Clock = std::chrono::system_clock;
+
+static std::string legacyFormatCurrentTime(Clock::time_point now) {
+  auto now_ms = std::chrono::time_point_cast<std::chrono::milliseconds>(now);
+  auto now_s = std::chrono::time_point_cast<std::chrono::seconds>(now);
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now_ms - now_s);
+
+  std::time_t time = Clock::to_time_t(now);
+  std::tm local_time_buf;
+  std::tm* local_time = localtime_r(&time, &local_time_buf);
+
+  std::stringstream ss;
+  if (local_time) {
+    ss << std::put_time(local_time, "%Y-%m-%d %H:%M:%S") << "." << std::setfill('0') << std::setw(3) << ms.count();
+  } else {
+    ss << "ERROR-TIME." << std::setfill('0') << std::setw(3) << ms.count();
+  }
+  return ss.str();
+}
+
+template <typename F>
+static double nanosecondsPerCall(const int iterations, F&& format) {
+  size_t checksum = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    checksum += format(Clock::now());
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  if (checksum == 0) {
+    std::cerr << "unexpected checksum" << std::endl;
+  }
+  return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+template <typename F>
+static double nanosecondsPerRead(const int iterations, F&& now) {
+  int64_t checksum = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    checksum += now().time_since_epoch().count();
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  if (checksum == 0) {
+    std::cerr << "unexpected checksum" << std::endl;
+  }
+  return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+// Largest distance between a TscClock reading and the system clock readings around it.
+static int64_t maxTscDeviationNanoseconds(ulog::TscClock& tscClock, const int samples) {
+  int64_t maxDeviation = 0;
+  for (int i = 0; i < samples; ++i) {
+    const auto before = Clock::now();
+    const auto time = tscClock.now();
+    const auto after = Clock::now();
+    const auto deviation = time < before ? before - time : time > after ? time - after : Clock::duration::zero();
+    maxDeviation = std::max<int64_t>(maxDeviation, std::chrono::duration_cast<std::chrono::nanoseconds>(deviation).count());
+  }
+  return maxDeviation;
+}
+
+// Formats every 250ms over two days around the March and November DST transitions.
+static int countMismatchesAroundDst(const char* timezone) {
+  setenv("TZ", timezone, 1);
+  tzset();
+  ulog::TimestampCache::invalidate();
+
+  int mismatches = 0;
+  for (const std::time_t transition : {std::time_t(1710054000), std::time_t(1730613600)}) {
+    const auto start = Clock::from_time_t(transition - 24 * 3600);
+    for (auto t = start; t < start + std::chrono::hours(48); t += std::chrono::milliseconds(250)) {
+      if (legacyFormatCurrentTime(t) != ulog::TimestampCache::format(t)) {
+        ++mismatches;
+      }
+    }
+  }
+  return mismatches;
+}
+
+int main() {
+  constexpr int ITERATIONS = 2'000'000;
+
+  const double legacy = nanosecondsPerCall(ITERATIONS, [](Clock::time_point now) {
+    return legacyFormatCurrentTime(now).size();
+  });
+  const double cached = nanosecondsPerCall(ITERATIONS, [](Clock::time_point now) {
+    return ulog::TimestampCache::format(now).size();
+  });
+  const double cachedNoAlloc = nanosecondsPerCall(ITERATIONS, [](Clock::time_point now) {
+    char buffer[ulog::TimestampCache::MAX_FORMATTED_SIZE];
+    return ulog::TimestampCache::format(now, ulog::MICROSECONDS, buffer);
+  });
+
+  std::cout << std::fixed << std::setprecision(1)
+            << "localtime_r + put_time + stringstream: " << legacy << " ns/call" << std::endl
+            << "TimestampCache (std::string, ms):      " << cached << " ns/call ("
+            << legacy / cached << "x)" << std::endl
+            << "TimestampCache (char buffer, us):      " << cachedNoAlloc << " ns/call ("
+            << legacy / cachedNoAlloc << "x)" << std::endl;
+
+  ulog::TscClock tscClock;
+  tscClock.waitForCalibration();
+  const double systemClockRead = nanosecondsPerRead(ITERATIONS, [] { return Clock::now(); });
+  const double tscClockRead = nanosecondsPerRead(ITERATIONS, [&] { return tscClock.now(); });
+  std::cout << "std::chrono::system_clock::now():      " << systemClockRead << " ns/call" << std::endl
+            << "TscClock::now():                       " << tscClockRead << " ns/call ("
+            << (tscClock.usesCycleCounter() ? "cycle counter" : "steady_clock") << ", at most "
+            << maxTscDeviationNanoseconds(tscClock, 100'000) << " ns from the system clock)" << std::endl;
+
+  const int mismatches = countMismatchesAroundDst("America/New_York")
+                       + countMismatchesAroundDst("Europe/Paris");
+  std::cout << "Mismatches with the previous implementation around DST transitions: "
+            << mismatches << std::endl;
+  return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
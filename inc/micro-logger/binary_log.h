@@ -0,0 +1,556 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "log_buffer.h"
+#include "timestamp_cache.h"
+#include "value_formatter.h"
+
+namespace ulog {
+
+  // Encoding of the binary log format written by loggers in binary mode (see
+  // LoggerFactory::binaryMode), and its decoder.
+  //
+  // A binary log is a sequence of records:
+  //   'H' "ULOG" version                   written by each LogWriter when it starts
+  //   'S' siteId app level name precision  static part of a LogStream's lines ("format site")
+  //   'F' formatId count segments          literal segments of a `fmt` format string
+  //   'M' size siteId timestamp arguments  a log line
+  // Integers are little-endian; `size` is a fixed uint32 (bytes after it), `timestamp` a fixed
+  // int64 (nanoseconds since the epoch), the others varints. Strings are a varint length followed
+  // by the bytes. Each argument is a type tag followed by its raw value; values without a binary
+  // encoding (user types, durations, anything after a manipulator) are stored as text. A line
+  // written with `fmt` starts its arguments with '{' formatId, which stands for the format's first
+  // segment, and follows each of them with '}', which stands for the next one: the literals of the
+  // format string are written once per LogWriter, in its 'F' record, instead of in every line.
+  //
+  // Site and format IDs are unique within a process; a later 'S' or 'F' record with the same ID
+  // (e.g. from a later run appending to the same file) replaces the previous definition. Site 0 is
+  // reserved for lines that were formatted as text up front (e.g. the writer's own notices).
+  // Version 2 added the 'F' records; version 1 logs are still decoded.
+  class BinaryLog {
+  public:
+    static constexpr char HEADER = 'H';
+    static constexpr char SITE = 'S';
+    static constexpr char FORMAT = 'F';
+    static constexpr char MESSAGE = 'M';
+
+    static constexpr std::string_view MAGIC = "ULOG";
+    static constexpr char VERSION = 2;
+
+    static constexpr uint32_t RAW_TEXT_SITE = 0;
+
+    //// Argument type tags
+    static constexpr char SIGNED = 'i';
+    static constexpr char UNSIGNED = 'u';
+    static constexpr char FLOAT = 'g';
+    static constexpr char DOUBLE = 'f';
+    static constexpr char BOOL = 'b';
+    static constexpr char POINTER = 'p';
+    static constexpr char TEXT = 's';
+    static constexpr char FORMAT_START = '{';
+    static constexpr char NEXT_SEGMENT = '}';
+
+    //// Records
+    static void appendHeader(LogBuffer& buffer) {
+      buffer.append(HEADER);
+      buffer.append(MAGIC);
+      buffer.append(VERSION);
+    }
+
+    static void appendSite(
+      LogBuffer& buffer,
+      const uint32_t siteId,
+      const std::string_view formattedAppName,
+      const std::string_view formattedLogLevel,
+      const std::string_view formattedLoggerName,
+      const TimestampPrecision timestampPrecision
+    ) {
+      buffer.append(SITE);
+      appendVarint(buffer, siteId);
+      appendString(buffer, formattedAppName);
+      appendString(buffer, formattedLogLevel);
+      appendString(buffer, formattedLoggerName);
+      buffer.append(static_cast<char>(timestampPrecision));
+    }
+
+    static void appendFormat(LogBuffer& buffer, const uint32_t formatId, const std::span<const std::string_view> segments) {
+      buffer.append(FORMAT);
+      appendVarint(buffer, formatId);
+      appendVarint(buffer, segments.size());
+      for (const std::string_view segment : segments) {
+        appendString(buffer, segment);
+      }
+    }
+
+    // Starts a 'M' record; its arguments are appended afterwards, then `endMessage()`.
+    static void beginMessage(LogBuffer& buffer, const uint32_t siteId, const int64_t timestamp) {
+      buffer.append(MESSAGE);
+      appendFixed<uint32_t>(buffer, 0); // size, patched by endMessage
+      appendVarint(buffer, siteId);
+      appendFixed<uint64_t>(buffer, static_cast<uint64_t>(timestamp));
+    }
+
+    // Patches the size of the 'M' record that starts at `messageOffset`.
+    static void endMessage(LogBuffer& buffer, const size_t messageOffset) {
+      const auto size = static_cast<uint32_t>(buffer.size() - messageOffset - 1 - sizeof(uint32_t));
+      char* sizeField = const_cast<char*>(buffer.data()) + messageOffset + 1;
+      for (size_t i = 0; i < sizeof(uint32_t); ++i) {
+        sizeField[i] = static_cast<char>((size >> (8 * i)) & 0xFF);
+      }
+    }
+
+    //// Arguments
+    template <typename T>
+    static void appendInteger(LogBuffer& buffer, const T value) {
+      if constexpr (std::is_signed_v<T>) {
+        buffer.append(SIGNED);
+        const auto wide = static_cast<int64_t>(value);
+        appendVarint(buffer, (static_cast<uint64_t>(wide) << 1) ^ static_cast<uint64_t>(wide >> 63));
+      } else {
+        buffer.append(UNSIGNED);
+        appendVarint(buffer, static_cast<uint64_t>(value));
+      }
+    }
+
+    template <typename T>
+    static void appendFloatingPoint(LogBuffer& buffer, const T value) {
+      if constexpr (std::is_same_v<T, float>) {
+        buffer.append(FLOAT);
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        appendFixed(buffer, bits);
+      } else if constexpr (std::is_same_v<T, double>) {
+        buffer.append(DOUBLE);
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        appendFixed(buffer, bits);
+      } else {
+        LogBuffer text;
+        ValueFormatter::appendFloatingPoint(text, value);
+        appendText(buffer, text.view());
+      }
+    }
+
+    static void appendBool(LogBuffer& buffer, const bool value) {
+      buffer.append(BOOL);
+      buffer.append(static_cast<char>(value));
+    }
+
+    static void appendPointer(LogBuffer& buffer, const void* value) {
+      buffer.append(POINTER);
+      appendVarint(buffer, reinterpret_cast<std::uintptr_t>(value));
+    }
+
+    static void appendText(LogBuffer& buffer, const std::string_view value) {
+      buffer.append(TEXT);
+      appendString(buffer, value);
+    }
+
+    // The first segment of the format `formatId` (see appendFormat), then each argument followed
+    // by `appendNextSegment`.
+    static void appendFormatStart(LogBuffer& buffer, const uint32_t formatId) {
+      buffer.append(FORMAT_START);
+      appendVarint(buffer, formatId);
+    }
+
+    static void appendNextSegment(LogBuffer& buffer) {
+      buffer.append(NEXT_SEGMENT);
+    }
+
+    //// Primitives
+    static void appendVarint(LogBuffer& buffer, uint64_t value) {
+      char* out = buffer.reserve(10);
+      size_t size = 0;
+      while (value >= 0x80) {
+        out[size++] = static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+      }
+      out[size++] = static_cast<char>(value);
+      buffer.commit(size);
+    }
+
+    template <typename T>
+    static void appendFixed(LogBuffer& buffer, const T value) {
+      char* out = buffer.reserve(sizeof(T));
+      for (size_t i = 0; i < sizeof(T); ++i) {
+        out[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+      }
+      buffer.commit(sizeof(T));
+    }
+
+    static void appendString(LogBuffer& buffer, const std::string_view value) {
+      appendVarint(buffer, value.size());
+      buffer.append(value);
+    }
+  };
+
+  // Turns binary log records back into the text lines LogMessageBuilder would have written.
+  //
+  // Records can be fed in arbitrary chunks; incomplete trailing bytes are kept until the next call.
+  // Timestamps are converted with the local timezone of the decoding process.
+  class BinaryLogDecoder {
+  public:
+    // Decodes every complete record of `data`, calling `onLine(std::string_view line)` for each
+    // log line (including its trailing '\n'). Returns false if the data is corrupted.
+    template <typename F>
+    bool decode(const std::string_view data, F&& onLine) {
+      _pending.append(data);
+      size_t offset = 0;
+      bool valid = true;
+      while (offset < _pending.size()) {
+        Reader reader(_pending, offset);
+        const Status status = decodeRecord(reader, onLine);
+        if (status == INCOMPLETE) {
+          break;
+        }
+        if (status == CORRUPTED) {
+          valid = false;
+          if (reader.offset <= offset) {
+            reader.offset = offset + 1; // resynchronize on the next byte
+          }
+        }
+        offset = reader.offset;
+      }
+      _pending.erase(0, offset);
+      return valid;
+    }
+
+    // True if bytes of an incomplete record are waiting for more data.
+    [[nodiscard]] bool pending() const {
+      return !_pending.empty();
+    }
+
+  private:
+    enum Status { DECODED, INCOMPLETE, CORRUPTED };
+
+    struct Site {
+      std::string        formattedAppName;
+      std::string        formattedLogLevel;
+      std::string        formattedLoggerName;
+      TimestampPrecision timestampPrecision;
+    };
+
+    struct Reader {
+      const std::string& data;
+      size_t             offset;
+      bool               truncated = false;
+
+      Reader(const std::string& input, const size_t start) : data(input), offset(start) {
+        // empty
+      }
+
+      bool has(const size_t size) {
+        if (data.size() - offset < size) {
+          truncated = true;
+          return false;
+        }
+        return true;
+      }
+
+      bool byte(char& value) {
+        if (!has(1)) {
+          return false;
+        }
+        value = data[offset++];
+        return true;
+      }
+
+      template <typename T>
+      bool fixed(T& value) {
+        if (!has(sizeof(T))) {
+          return false;
+        }
+        value = 0;
+        for (size_t i = 0; i < sizeof(T); ++i) {
+          value |= static_cast<T>(static_cast<unsigned char>(data[offset + i])) << (8 * i);
+        }
+        offset += sizeof(T);
+        return true;
+      }
+
+      bool varint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+          char c;
+          if (!byte(c)) {
+            return false;
+          }
+          value |= static_cast<uint64_t>(c & 0x7F) << shift;
+          if ((c & 0x80) == 0) {
+            return true;
+          }
+        }
+        return false;
+      }
+
+      bool string(std::string_view& value) {
+        uint64_t size;
+        if (!varint(size) || !has(size)) {
+          return false;
+        }
+        value = std::string_view(data).substr(offset, size);
+        offset += size;
+        return true;
+      }
+    };
+
+    std::string                            _pending;
+    std::unordered_map<uint32_t, Site>     _sites;
+    std::unordered_map<uint32_t, std::vector<std::string>> _formats;
+    LogBuffer                              _line;
+
+    // The format of the line being decoded (nullptr outside `fmt` lines), and its next segment
+    const std::vector<std::string>*        _format = nullptr;
+    size_t                                 _nextSegment = 0;
+
+    static Status failure(const Reader& reader) {
+      return reader.truncated ? INCOMPLETE : CORRUPTED;
+    }
+
+    template <typename F>
+    Status decodeRecord(Reader& reader, F& onLine) {
+      char type;
+      if (!reader.byte(type)) {
+        return INCOMPLETE;
+      }
+      switch (type) {
+        case BinaryLog::HEADER: {
+          if (!reader.has(BinaryLog::MAGIC.size() + 1)) {
+            return INCOMPLETE;
+          }
+          const char version = reader.data[reader.offset + BinaryLog::MAGIC.size()];
+          const bool valid = std::string_view(reader.data).substr(reader.offset, BinaryLog::MAGIC.size()) == BinaryLog::MAGIC
+                             && version >= 1 && version <= BinaryLog::VERSION;
+          reader.offset += BinaryLog::MAGIC.size() + 1;
+          return valid ? DECODED : CORRUPTED;
+        }
+        case BinaryLog::SITE:
+          return decodeSite(reader);
+        case BinaryLog::FORMAT:
+          return decodeFormat(reader);
+        case BinaryLog::MESSAGE:
+          return decodeMessage(reader, onLine);
+        default:
+          return CORRUPTED;
+      }
+    }
+
+    Status decodeSite(Reader& reader) {
+      uint64_t siteId;
+      std::string_view appName, logLevel, loggerName;
+      char precision;
+      if (!reader.varint(siteId) || !reader.string(appName) || !reader.string(logLevel)
+          || !reader.string(loggerName) || !reader.byte(precision)) {
+        return failure(reader);
+      }
+      if (precision != MILLISECONDS && precision != MICROSECONDS && precision != NANOSECONDS) {
+        return CORRUPTED;
+      }
+      _sites[static_cast<uint32_t>(siteId)] = Site {
+        std::string(appName), std::string(logLevel), std::string(loggerName),
+        static_cast<TimestampPrecision>(precision)
+      };
+      return DECODED;
+    }
+
+    Status decodeFormat(Reader& reader) {
+      uint64_t formatId;
+      uint64_t count;
+      if (!reader.varint(formatId) || !reader.varint(count)) {
+        return failure(reader);
+      }
+      std::vector<std::string> segments;
+      for (uint64_t index = 0; index < count; ++index) {
+        std::string_view segment;
+        if (!reader.string(segment)) {
+          return failure(reader);
+        }
+        segments.emplace_back(segment);
+      }
+      _formats[static_cast<uint32_t>(formatId)] = std::move(segments);
+      return DECODED;
+    }
+
+    template <typename F>
+    Status decodeMessage(Reader& reader, F& onLine) {
+      uint32_t size;
+      if (!reader.fixed(size)) {
+        return failure(reader);
+      }
+      if (!reader.has(size)) {
+        return INCOMPLETE;
+      }
+      const size_t end = reader.offset + size;
+
+      uint64_t siteId;
+      uint64_t timestamp;
+      if (!reader.varint(siteId) || !reader.fixed(timestamp) || reader.offset > end) {
+        return CORRUPTED;
+      }
+
+      _line.clear();
+      _format = nullptr;
+      if (siteId != BinaryLog::RAW_TEXT_SITE) {
+        const auto site = _sites.find(static_cast<uint32_t>(siteId));
+        if (site == _sites.end()) {
+          reader.offset = end;
+          return CORRUPTED;
+        }
+        const auto time = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          std::chrono::nanoseconds(static_cast<int64_t>(timestamp))
+        ));
+        _line.append(site->second.formattedAppName);
+        _line.commit(TimestampCache::format(
+          time, site->second.timestampPrecision, _line.reserve(TimestampCache::MAX_FORMATTED_SIZE)
+        ));
+        _line.append(std::string_view(" | "));
+        _line.append(site->second.formattedLogLevel);
+        _line.append(std::string_view(" | "));
+        _line.append(site->second.formattedLoggerName);
+        _line.append(std::string_view(" | "));
+      }
+
+      while (reader.offset < end) {
+        if (!decodeArgument(reader) || reader.offset > end) {
+          reader.offset = end;
+          return CORRUPTED;
+        }
+      }
+      if (siteId != BinaryLog::RAW_TEXT_SITE) {
+        _line.append('\n');
+      }
+      onLine(_line.view());
+      return DECODED;
+    }
+
+    bool decodeArgument(Reader& reader) {
+      char type;
+      if (!reader.byte(type)) {
+        return false;
+      }
+      switch (type) {
+        case BinaryLog::SIGNED: {
+          uint64_t zigzag;
+          if (!reader.varint(zigzag)) {
+            return false;
+          }
+          ValueFormatter::appendInteger(_line, static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1));
+          return true;
+        }
+        case BinaryLog::UNSIGNED: {
+          uint64_t value;
+          if (!reader.varint(value)) {
+            return false;
+          }
+          ValueFormatter::appendInteger(_line, value);
+          return true;
+        }
+        case BinaryLog::FLOAT: {
+          uint32_t bits;
+          float value;
+          if (!reader.fixed(bits)) {
+            return false;
+          }
+          std::memcpy(&value, &bits, sizeof(value));
+          ValueFormatter::appendFloatingPoint(_line, value);
+          return true;
+        }
+        case BinaryLog::DOUBLE: {
+          uint64_t bits;
+          double value;
+          if (!reader.fixed(bits)) {
+            return false;
+          }
+          std::memcpy(&value, &bits, sizeof(value));
+          ValueFormatter::appendFloatingPoint(_line, value);
+          return true;
+        }
+        case BinaryLog::BOOL: {
+          char value;
+          if (!reader.byte(value)) {
+            return false;
+          }
+          ValueFormatter::appendBool(_line, value != 0);
+          return true;
+        }
+        case BinaryLog::POINTER: {
+          uint64_t value;
+          if (!reader.varint(value)) {
+            return false;
+          }
+          ValueFormatter::appendPointer(_line, reinterpret_cast<const void*>(static_cast<std::uintptr_t>(value)));
+          return true;
+        }
+        case BinaryLog::TEXT: {
+          std::string_view value;
+          if (!reader.string(value)) {
+            return false;
+          }
+          _line.append(value);
+          return true;
+        }
+        case BinaryLog::FORMAT_START: {
+          uint64_t formatId;
+          if (!reader.varint(formatId)) {
+            return false;
+          }
+          const auto format = _formats.find(static_cast<uint32_t>(formatId));
+          if (format == _formats.end() || format->second.empty()) {
+            return false;
+          }
+          _format = &format->second;
+          _line.append((*_format)[0]);
+          _nextSegment = 1;
+          return true;
+        }
+        case BinaryLog::NEXT_SEGMENT:
+          if (_format == nullptr || _nextSegment >= _format->size()) {
+            return false;
+          }
+          _line.append((*_format)[_nextSegment++]);
+          return true;
+        default:
+          return false;
+      }
+    }
+  };
+
+} // namespace ulog
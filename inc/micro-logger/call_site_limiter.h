@@ -0,0 +1,214 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "log_stream.h"
+
+namespace ulog {
+
+  // Rate limiters for a single logging statement, normally declared by the ULOG_EVERY_N,
+  // ULOG_AT_MOST_PER_SECOND and ULOG_TOKEN_BUCKET macros as a static at the call site.
+  //
+  // Each limiter has its own cache line, and a throttled call is a couple of relaxed atomic
+  // operations: nothing is formatted. The rate limiters (not EveryN, which is sampling) count the
+  // calls they suppress and write a "N messages suppressed" line before the next line they let
+  // through. If no call gets through, e.g. at the end of a storm, the LogWriter writes the count
+  // as a notice instead: from its flusher thread once the call site has been quiet for
+  // QUIET_PERIOD, and on flush and shutdown.
+  class alignas(64) CallSiteLimiter : public DeferredNotice {
+  public:
+    static constexpr auto QUIET_PERIOD = std::chrono::seconds(1);
+
+    std::optional<std::string> takeNotice(const bool force) override {
+      const auto quietFor = std::chrono::nanoseconds(nowNanoseconds() - _lastSuppressed.load(std::memory_order_relaxed));
+      if (!force && quietFor < QUIET_PERIOD) {
+        return std::nullopt;
+      }
+      _deferred.store(false);
+      const uint64_t suppressed = _suppressed.exchange(0);
+      return suppressed == 0 ? std::string() : suppressedMessage(suppressed);
+    }
+
+  protected:
+    CallSiteLimiter(const char* file, const int line) : _file(file), _line(line) {
+      // empty
+    }
+
+    // The first call suppressed since the count was last reported hands the limiter to the
+    // stream's writer, in case no later call gets through to report it. Sequentially consistent:
+    // either takeNotice's exchange sees this call, or this call sees `_deferred` cleared.
+    void suppress(const LogStream& stream, const int64_t now) {
+      _lastSuppressed.store(now, std::memory_order_relaxed);
+      if (_suppressed.fetch_add(1) == 0 && !_deferred.exchange(true)) {
+        stream.deferNotice(this);
+      }
+    }
+
+    // Called for each call let through: reports the calls suppressed since the previous one.
+    void reportSuppressed(const LogStream& stream) {
+      if (_suppressed.load(std::memory_order_relaxed) == 0) {
+        return;
+      }
+      const uint64_t suppressed = _suppressed.exchange(0, std::memory_order_relaxed);
+      if (suppressed > 0) {
+        stream << suppressed << " messages suppressed by the rate limit at " << _file << ':' << _line;
+      }
+    }
+
+    static int64_t nowNanoseconds() {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+      ).count();
+    }
+
+  private:
+    std::atomic<uint64_t> _suppressed{0};
+    std::atomic<int64_t>  _lastSuppressed{0};  // nowNanoseconds() of the last call suppressed
+    std::atomic<bool>     _deferred{false};     // whether a writer holds this limiter's count
+    const char*           _file;
+    int                   _line;
+
+    [[nodiscard]] std::string suppressedMessage(const uint64_t suppressed) const {
+      return std::to_string(suppressed) + " messages suppressed by the rate limit at " + _file + ':' + std::to_string(_line);
+    }
+  };
+
+  // Lets through the 1st, (n+1)th, (2n+1)th... call.
+  class EveryN : public CallSiteLimiter {
+  public:
+    EveryN(const char* file, const int line, const uint64_t n)
+        : CallSiteLimiter(file, line),
+          _n(std::max<uint64_t>(n, 1)) {
+      // empty
+    }
+
+    bool allow(const LogStream&) {
+      return _calls.fetch_add(1, std::memory_order_relaxed) % _n == 0;
+    }
+
+  private:
+    std::atomic<uint64_t> _calls{0};
+    uint64_t              _n;
+  };
+
+  // Lets through at most `maxPerSecond` calls per second (fixed one-second windows).
+  class AtMostPerSecond : public CallSiteLimiter {
+  public:
+    AtMostPerSecond(const char* file, const int line, const uint32_t maxPerSecond)
+        : CallSiteLimiter(file, line),
+          _maxPerSecond(maxPerSecond) {
+      // empty
+    }
+
+    bool allow(const LogStream& stream) {
+      const int64_t now = nowNanoseconds();
+      const auto second = static_cast<uint64_t>(now / 1000000000);
+      uint64_t state = _state.load(std::memory_order_relaxed);
+      for (;;) {
+        uint64_t desired;
+        if (state >> COUNT_BITS < second) { // windows only move forward, whatever the thread's clock read
+          desired = (second << COUNT_BITS) | 1;
+        } else if ((state & COUNT_MASK) >= _maxPerSecond) {
+          suppress(stream, now);
+          return false;
+        } else {
+          desired = state + 1;
+        }
+        if (_state.compare_exchange_weak(state, desired, std::memory_order_relaxed)) {
+          reportSuppressed(stream);
+          return true;
+        }
+      }
+    }
+
+  private:
+    static constexpr int COUNT_BITS = 32;
+    static constexpr uint64_t COUNT_MASK = (uint64_t(1) << COUNT_BITS) - 1;
+
+    std::atomic<uint64_t> _state{0}; // window's second << COUNT_BITS | calls let through in it
+    uint32_t              _maxPerSecond;
+  };
+
+  // Token bucket of `burst` tokens refilled at `tokensPerSecond`, implemented as a generic cell
+  // rate algorithm: a single timestamp, no refill thread.
+  class TokenBucket : public CallSiteLimiter {
+  public:
+    TokenBucket(const char* file, const int line, const double tokensPerSecond, const uint32_t burst)
+        : CallSiteLimiter(file, line),
+          _interval(static_cast<int64_t>(1e9 / std::max(tokensPerSecond, 1e-9))),
+          _tolerance(_interval * (static_cast<int64_t>(std::max<uint32_t>(burst, 1)) - 1)) {
+      // empty
+    }
+
+    bool allow(const LogStream& stream) {
+      const int64_t now = nowNanoseconds();
+      int64_t theoreticalArrival = _theoreticalArrival.load(std::memory_order_relaxed);
+      for (;;) {
+        const int64_t start = std::max(theoreticalArrival, now);
+        if (start - now > _tolerance) {
+          suppress(stream, now);
+          return false;
+        }
+        if (_theoreticalArrival.compare_exchange_weak(theoreticalArrival, start + _interval, std::memory_order_relaxed)) {
+          reportSuppressed(stream);
+          return true;
+        }
+      }
+    }
+
+  private:
+    std::atomic<int64_t> _theoreticalArrival{0};
+    int64_t               _interval;  // ns per token
+    int64_t               _tolerance; // ns of burst
+  };
+
+} // namespace ulog
+
+// Rate-limited logging statements, limited per call site (the limiter's arguments are read once):
+//   ULOG_EVERY_N(logger.debug, 1000) << "sampled";
+//   ULOG_AT_MOST_PER_SECOND(logger.error, 10) << "retry failed: " << error;
+//   ULOG_TOKEN_BUCKET(logger.warning, 5, 50) << "slow request";   // 5/s, bursts of 50
+// Like ULOG_INFO and co., the operands are only evaluated if the line is written.
+#define ULOG_LIMITED_(stream, limiterType, ...) \
+  if (static limiterType ulogLimiter_{__FILE__, __LINE__, __VA_ARGS__}; \
+      !((stream).enabled() && ulogLimiter_.allow(stream))) {} else (stream)
+
+#define ULOG_EVERY_N(stream, n)                           ULOG_LIMITED_(stream, ::ulog::EveryN, n)
+#define ULOG_AT_MOST_PER_SECOND(stream, maxPerSecond)     ULOG_LIMITED_(stream, ::ulog::AtMostPerSecond, maxPerSecond)
+#define ULOG_TOKEN_BUCKET(stream, tokensPerSecond, burst) ULOG_LIMITED_(stream, ::ulog::TokenBucket, tokensPerSecond, burst)
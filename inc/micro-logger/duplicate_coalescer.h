@@ -0,0 +1,149 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "log_level.h"
+#include "timestamp_cache.h"
+
+namespace ulog {
+
+  // Collapses runs of identical lines, like the same ERROR logged thousands of times per second
+  // while a dependency is down: the first line of a run is written, the repeats are only counted,
+  // and a summary (the count, and the timestamps of the first and last repeats) is written once
+  // the run ends with a different line. A long run gets a summary every `window`, counted from
+  // its first unreported repeat; the window is checked every `CLOCK_CHECK_INTERVAL` repeats, as
+  // reading the clock would cost more than the rest (the LogWriter also checks it periodically).
+  //
+  // Lines are compared byte by byte with the previous one, on everything but their timestamp (app
+  // and logger names, level, message and fields): the comparison stops at the first difference,
+  // and the previous line is kept in a buffer that only allocates when it grows.
+  class DuplicateCoalescer {
+  public:
+    static constexpr auto DEFAULT_WINDOW = std::chrono::milliseconds(5000);
+    static constexpr uint64_t CLOCK_CHECK_INTERVAL = 32;
+
+    // Repeats of a line not reported yet.
+    struct Run {
+      uint64_t    repeats = 0; // 0: nothing to report
+      LogLevel    level = DEBUG;
+      std::string firstTime;
+      std::string lastTime;
+    };
+
+    explicit DuplicateCoalescer(const std::chrono::milliseconds window) : _window(window) {
+      _lastLine.reserve(INITIAL_LINE_CAPACITY);
+      _run.firstTime.reserve(TimestampCache::MAX_FORMATTED_SIZE);
+      _run.lastTime.reserve(TimestampCache::MAX_FORMATTED_SIZE);
+    }
+
+    DuplicateCoalescer(const DuplicateCoalescer&) = delete;
+    DuplicateCoalescer& operator=(const DuplicateCoalescer&) = delete;
+
+    // Whether `line` (of which `time` is the timestamp) repeats the previous line, and is only
+    // counted. `ended` gets the run the line ends, if any, to report before it.
+    bool add(const std::string_view line, const std::string_view time, const LogLevel level, Run& ended) {
+      const auto timeOffset = static_cast<size_t>(time.data() - line.data());
+      const std::string_view beforeTime = line.substr(0, timeOffset);
+      const std::string_view afterTime = line.substr(timeOffset + time.size());
+
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (!isLastLine(beforeTime, afterTime)) {
+        if (_run.repeats > 0) {
+          take(ended);
+        }
+        _lastLine.assign(beforeTime);
+        _lastLine.append(afterTime);
+        _lastTimeOffset = beforeTime.size();
+        return false;
+      }
+
+      if (_run.repeats > 0 && _run.repeats % CLOCK_CHECK_INTERVAL == 0
+          && std::chrono::steady_clock::now() - _runStart >= _window) {
+        take(ended);
+      }
+      if (_run.repeats++ == 0) {
+        _runStart = std::chrono::steady_clock::now();
+        _run.level = level;
+        _run.firstTime.assign(time);
+      }
+      _run.lastTime.assign(time);
+      return true;
+    }
+
+    // Takes the current run into `ended` if its window has passed, or with `force`; false if
+    // there is nothing to report.
+    bool expire(const bool force, Run& ended) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_run.repeats == 0 || (!force && std::chrono::steady_clock::now() - _runStart < _window)) {
+        return false;
+      }
+      take(ended);
+      return true;
+    }
+
+    [[nodiscard]] std::chrono::milliseconds window() const {
+      return _window;
+    }
+
+  private:
+    static constexpr size_t INITIAL_LINE_CAPACITY = 512;
+    static constexpr size_t NO_LINE = SIZE_MAX;
+
+    std::chrono::milliseconds             _window;
+    std::mutex                            _mutex;
+    std::string                           _lastLine; // without its timestamp; under _mutex, as the rest
+    size_t                                _lastTimeOffset = NO_LINE;
+    Run                                   _run;
+    std::chrono::steady_clock::time_point _runStart;
+
+    [[nodiscard]] bool isLastLine(const std::string_view beforeTime, const std::string_view afterTime) const {
+      return _lastTimeOffset == beforeTime.size()
+          && _lastLine.size() == beforeTime.size() + afterTime.size()
+          && std::memcmp(_lastLine.data() + beforeTime.size(), afterTime.data(), afterTime.size()) == 0
+          && std::memcmp(_lastLine.data(), beforeTime.data(), beforeTime.size()) == 0;
+    }
+
+    void take(Run& ended) {
+      ended = _run; // keeps _run's capacity
+      _run.repeats = 0;
+    }
+  };
+
+} // namespace ulog
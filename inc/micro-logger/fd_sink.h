@@ -0,0 +1,214 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#if defined(_WIN32)
+#error "FdSink is only available on POSIX platforms"
+#endif
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "log_sink.h"
+
+namespace ulog {
+
+  // Writes the logs straight to a file descriptor (a file opened with O_APPEND, a pipe, stdout),
+  // without std::ostream in between.
+  //
+  // Lines are gathered in a buffer of `bufferSize` bytes, written out with a single writev when the
+  // next line doesn't fit (the buffer and that line together) or on `flush()`; with a `bufferSize`
+  // of 0, every line is written by its own call. The batches are cut between lines, so:
+  //  - with a regular file opened with O_APPEND, each batch is appended in one piece, and several
+  //    processes can share the file without lines of one being torn by the others;
+  //  - with a pipe (or a FIFO), batches are at most PIPE_BUF bytes, the size up to which the kernel
+  //    writes them atomically; a line longer than that is written alone, and may be interleaved.
+  // Short writes are resumed where they stopped, EINTR is retried, and a non-blocking descriptor is
+  // waited for with poll. Lines that can't be written (e.g. EPIPE, disk full) are dropped and counted
+  // in `droppedBytes()`.
+  class FdSink : public LogSink {
+  public:
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+    // Opens (or creates) the file at `path` in append mode.
+    explicit FdSink(const std::string& path, const size_t bufferSize = DEFAULT_BUFFER_SIZE)
+        : FdSink(::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644), true, bufferSize) {
+      // empty
+    }
+
+    // Writes to `fd` (e.g. STDOUT_FILENO), closing it on destruction if `ownsFd`.
+    explicit FdSink(const int fd, const bool ownsFd = false, const size_t bufferSize = DEFAULT_BUFFER_SIZE)
+        : _fd(fd),
+          _ownsFd(ownsFd),
+          _pipe(isPipe(fd)),
+          _batchSize(_pipe && bufferSize > PIPE_BUF ? PIPE_BUF : bufferSize) {
+      _pending.reserve(_batchSize);
+    }
+
+    FdSink(const FdSink&) = delete;
+    FdSink& operator=(const FdSink&) = delete;
+
+    ~FdSink() override {
+      writePending();
+      if (_ownsFd && _fd >= 0) {
+        ::close(_fd);
+      }
+    }
+
+    void write(const char* data, const size_t size) override {
+      if (_pending.size() + size <= _batchSize) {
+        _pending.append(data, size);
+        return;
+      }
+      if (!_pending.empty() && (!_pipe || _pending.size() + size <= PIPE_BUF)) {
+        // one system call for the buffer and the line, without copying the line
+        iovec vectors[2] = {
+          {_pending.data(), _pending.size()},
+          {const_cast<char*>(data), size}
+        };
+        writeAll(vectors, 2);
+        _pending.clear();
+        return;
+      }
+      writePending();
+      if (size <= _batchSize) {
+        _pending.append(data, size);
+      } else {
+        iovec vector = {const_cast<char*>(data), size};
+        writeAll(&vector, 1);
+      }
+    }
+
+    // Hands the buffered lines to the kernel; doesn't sync the file to the disk.
+    void flush() override {
+      writePending();
+    }
+
+    [[nodiscard]] bool isOpen() const {
+      return _fd >= 0;
+    }
+
+    [[nodiscard]] uint64_t droppedBytes() const {
+      return _droppedBytes.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] int fd() const {
+      return _fd;
+    }
+
+  private:
+    int                   _fd;
+    bool                  _ownsFd;
+    bool                  _pipe;
+    size_t                _batchSize; // of the gathered lines; at most PIPE_BUF for pipes
+    std::string           _pending;
+    std::atomic<uint64_t> _droppedBytes{0};
+
+    void writePending() {
+      if (_pending.empty()) {
+        return;
+      }
+      iovec vector = {_pending.data(), _pending.size()};
+      writeAll(&vector, 1);
+      _pending.clear();
+    }
+
+    void writeAll(iovec* vectors, int count) {
+      if (_fd < 0) { // the file couldn't be opened: errno is stale, don't retry on it
+        dropAll(vectors, count);
+        return;
+      }
+      while (count > 0) {
+        const ssize_t written = ::writev(_fd, vectors, count);
+        if (written < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          if ((errno == EAGAIN || errno == EWOULDBLOCK) && waitWritable()) {
+            continue;
+          }
+          dropAll(vectors, count);
+          return;
+        }
+
+        // short write (pipe full, signal, disk quota...): resume after what was written
+        auto remaining = static_cast<size_t>(written);
+        while (count > 0 && remaining >= vectors->iov_len) {
+          remaining -= vectors->iov_len;
+          ++vectors;
+          --count;
+        }
+        if (count > 0) {
+          vectors->iov_base = static_cast<char*>(vectors->iov_base) + remaining;
+          vectors->iov_len -= remaining;
+        }
+      }
+    }
+
+    void dropAll(const iovec* vectors, const int count) {
+      for (int index = 0; index < count; ++index) {
+        _droppedBytes.fetch_add(vectors[index].iov_len, std::memory_order_relaxed);
+      }
+    }
+
+    // For a non-blocking descriptor (e.g. a pipe shared with a process that set O_NONBLOCK).
+    bool waitWritable() const {
+      pollfd descriptor = {_fd, POLLOUT, 0};
+      while (true) {
+        const int ready = ::poll(&descriptor, 1, -1);
+        if (ready > 0) {
+          return (descriptor.revents & (POLLERR | POLLNVAL)) == 0;
+        }
+        if (ready < 0 && errno != EINTR) {
+          return false;
+        }
+      }
+    }
+
+    static bool isPipe(const int fd) {
+      struct stat status {};
+      return fd >= 0 && ::fstat(fd, &status) == 0 && S_ISFIFO(status.st_mode);
+    }
+  };
+
+} // namespace ulog
@@ -0,0 +1,297 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <csignal>
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+#include "log_level.h"
+
+namespace ulog {
+
+  // In-memory ring of the most recent formatted lines, written, or below the minimum level, to dump
+  // when something goes wrong: production can run at INFO and still get the DEBUG lines leading to
+  // an error.
+  //
+  // The `capacity` slots of `slotSize` bytes are allocated up front; recording a line is a memcpy
+  // into the next slot, without lock nor I/O (longer lines are truncated). A slot being rewritten
+  // while it is read is detected with its sequence number, and skipped.
+  //
+  // `dumpOnCrash` (POSIX only) writes the ring to a file descriptor from a SIGSEGV/SIGABRT handler,
+  // using only async-signal-safe calls, then lets the previous handler (e.g. the default one) run.
+  class FlightRecorder {
+  public:
+    static constexpr size_t DEFAULT_SLOT_SIZE = 256;
+
+    struct Line {
+      std::string text;
+      LogLevel    level;
+    };
+
+    explicit FlightRecorder(
+      const size_t capacity,
+      const LogLevel level = DEBUG,
+      const size_t slotSize = DEFAULT_SLOT_SIZE
+    ) : _capacity(std::max<size_t>(capacity, 1)),
+        _slotSize(std::max<size_t>(slotSize, 2)),
+        _level(level),
+        _slots(new Slot[_capacity]),
+        _data(new char[_capacity * _slotSize]) {
+      // empty
+    }
+
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    ~FlightRecorder() {
+#if !defined(_WIN32)
+      for (auto& target : crashTargets()) {
+        FlightRecorder* expected = this;
+        target.recorder.compare_exchange_strong(expected, nullptr);
+      }
+#endif
+    }
+
+    // Lines below this level are not recorded.
+    [[nodiscard]] LogLevel level() const {
+      return _level;
+    }
+
+    [[nodiscard]] size_t capacity() const {
+      return _capacity;
+    }
+
+    [[nodiscard]] size_t slotSize() const {
+      return _slotSize;
+    }
+
+    // `written`: whether the line also went to the sink (otherwise it was below the minimum level).
+    void record(const std::string_view line, const LogLevel level, const bool written) {
+      const uint64_t index = _next.fetch_add(1, std::memory_order_relaxed);
+      Slot& slot = _slots[index % _capacity];
+
+      // Skipped if a writer that wrapped around the ring is still on this slot. Acquire: the
+      // previous writer's release store of the slot happens before this one overwrites it.
+      uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+      if ((sequence & 1) != 0 || sequence > 2 * index
+          || !slot.sequence.compare_exchange_strong(sequence, 2 * index + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+        return;
+      }
+      std::atomic_thread_fence(std::memory_order_release);
+
+      char* data = slotData(index);
+      size_t size = std::min(line.size(), _slotSize);
+      std::memcpy(data, line.data(), size);
+      if (size < line.size()) {
+        data[size - 1] = '\n'; // truncated
+      }
+      slot.size = static_cast<uint32_t>(size);
+      slot.level = level;
+      slot.written = written;
+      slot.sequence.store(2 * index + 2, std::memory_order_release);
+    }
+
+    // Takes the lines recorded since the previous call, oldest first; with `unwrittenOnly`, only
+    // those that didn't go to the sink.
+    std::vector<Line> take(const bool unwrittenOnly) {
+      std::lock_guard<std::mutex> lock(_takeMutex);
+      const uint64_t end = _next.load(std::memory_order_acquire);
+      const uint64_t begin = std::max(_taken, end > _capacity ? end - _capacity : 0);
+      _taken = end;
+
+      std::vector<Line> lines;
+      for (uint64_t index = begin; index < end; ++index) {
+        const Slot& slot = _slots[index % _capacity];
+        if (slot.sequence.load(std::memory_order_acquire) != 2 * index + 2) {
+          continue; // overwritten, or being written
+        }
+        Line line{std::string(slotData(index), slot.size), slot.level};
+        const bool written = slot.written;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != 2 * index + 2 || (unwrittenOnly && written)) {
+          continue;
+        }
+        lines.push_back(std::move(line));
+      }
+      return lines;
+    }
+
+#if !defined(_WIN32)
+    // On SIGSEGV or SIGABRT, writes every line still in the ring to `fd` (e.g. STDERR_FILENO, or an
+    // FdSink's), written to the sink or not: what the sink had buffered may be lost with the process.
+    // Up to MAX_CRASH_TARGETS recorders can be registered.
+    //
+    // The handler runs on an alternate signal stack, so that a stack overflow can be dumped too;
+    // this installs one for the calling thread only. Other threads that may overflow their stack
+    // need `installAlternateStack()` (without it, their other crashes are still dumped).
+    bool dumpOnCrash(const int fd) {
+      installAlternateStack();
+      static std::once_flag installed;
+      std::call_once(installed, [] {
+        for (const int signal : CRASH_SIGNALS) {
+          struct sigaction action {};
+          action.sa_handler = &onCrash;
+          sigemptyset(&action.sa_mask);
+          action.sa_flags = SA_ONSTACK;
+          ::sigaction(signal, &action, &previousAction(signal));
+        }
+      });
+
+      for (auto& target : crashTargets()) {
+        FlightRecorder* expected = nullptr;
+        if (target.recorder.load() == this || target.recorder.compare_exchange_strong(expected, this)) {
+          target.fd.store(fd);
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // Gives the calling thread an alternate signal stack, unless it has one already; kept until the
+    // process exits.
+    static void installAlternateStack() {
+      stack_t current {};
+      if (::sigaltstack(nullptr, &current) == 0 && (current.ss_flags & SS_DISABLE) == 0) {
+        return;
+      }
+      const size_t size = std::max<size_t>(SIGSTKSZ, ALTERNATE_STACK_SIZE);
+      stack_t stack {};
+      stack.ss_sp = new char[size]; // not freed: the thread may crash at any time
+      stack.ss_size = size;
+      ::sigaltstack(&stack, nullptr);
+    }
+
+    // Async-signal-safe.
+    void writeTo(const int fd) const {
+      const uint64_t end = _next.load(std::memory_order_acquire);
+      const uint64_t begin = end > _capacity ? end - _capacity : 0;
+      writeAll(fd, CRASH_HEADER);
+      for (uint64_t index = begin; index < end; ++index) {
+        const Slot& slot = _slots[index % _capacity];
+        if (slot.sequence.load(std::memory_order_acquire) == 2 * index + 2) {
+          writeAll(fd, std::string_view(slotData(index), slot.size));
+        }
+      }
+      writeAll(fd, CRASH_FOOTER);
+    }
+
+    static constexpr size_t MAX_CRASH_TARGETS = 8;
+#endif
+
+  private:
+    struct Slot {
+      std::atomic<uint64_t> sequence{0}; // 2 * index + 1 while written, 2 * index + 2 once written
+      uint32_t              size = 0;
+      LogLevel              level = DEBUG;
+      bool                  written = false;
+    };
+
+    size_t                  _capacity;
+    size_t                  _slotSize;
+    LogLevel                _level;
+    std::unique_ptr<Slot[]> _slots;
+    std::unique_ptr<char[]> _data;
+    std::atomic<uint64_t>   _next{0};
+
+    std::mutex              _takeMutex;
+    uint64_t                _taken = 0; // under _takeMutex
+
+    [[nodiscard]] char* slotData(const uint64_t index) const {
+      return _data.get() + (index % _capacity) * _slotSize;
+    }
+
+#if !defined(_WIN32)
+    static constexpr int CRASH_SIGNALS[] = {SIGSEGV, SIGABRT};
+    static constexpr size_t ALTERNATE_STACK_SIZE = 64 * 1024;
+    static constexpr std::string_view CRASH_HEADER = "---- Flight recorder: most recent lines ----\n";
+    static constexpr std::string_view CRASH_FOOTER = "---- End of the flight recorder ----\n";
+
+    struct CrashTarget {
+      std::atomic<FlightRecorder*> recorder{nullptr};
+      std::atomic<int>             fd{-1};
+    };
+
+    static std::array<CrashTarget, MAX_CRASH_TARGETS>& crashTargets() {
+      static std::array<CrashTarget, MAX_CRASH_TARGETS> targets;
+      return targets;
+    }
+
+    static struct sigaction& previousAction(const int signal) {
+      static struct sigaction previousActions[2]; // SIGSEGV, SIGABRT
+      return previousActions[signal == SIGSEGV ? 0 : 1];
+    }
+
+    static void onCrash(const int signal) {
+      const int savedErrno = errno;
+      for (auto& target : crashTargets()) {
+        if (const FlightRecorder* recorder = target.recorder.exchange(nullptr)) { // once per recorder
+          recorder->writeTo(target.fd.load());
+        }
+      }
+      errno = savedErrno;
+
+      // Lets the previous handler deal with the signal
+      ::sigaction(signal, &previousAction(signal), nullptr);
+      ::raise(signal);
+    }
+
+    static void writeAll(const int fd, std::string_view data) {
+      while (!data.empty()) {
+        const ssize_t written = ::write(fd, data.data(), data.size());
+        if (written < 0 && errno == EINTR) {
+          continue;
+        }
+        if (written <= 0) {
+          return;
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+      }
+    }
+#endif
+  };
+
+} // namespace ulog
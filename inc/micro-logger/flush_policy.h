@@ -0,0 +1,100 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "log_level.h"
+
+namespace ulog {
+
+  // When a LogWriter flushes its output, as any combination of:
+  //  - every N lines,
+  //  - every T milliseconds (by the async writer thread, or a small flusher thread in synchronous
+  //    mode, so the last lines don't wait for the next one),
+  //  - right after a line at or above a level (e.g. WARNING).
+  //
+  // Flushes are coalesced: one flush covers every line written before it, whichever thread
+  // requested it. The default policy never flushes, leaving it to the stream (or to
+  // LoggerFactory::flush()).
+  class FlushPolicy {
+  public:
+    static constexpr uint32_t NO_LINE_LIMIT = 0;
+    static constexpr auto NO_INTERVAL = std::chrono::milliseconds::zero();
+    static constexpr int NO_LEVEL = ULOG_LEVEL_OFF;
+
+    // Flushes after every line, like `alwaysFlush`.
+    static FlushPolicy always() {
+      return FlushPolicy().everyLines(1);
+    }
+
+    static FlushPolicy never() {
+      return {};
+    }
+
+//// Setter
+    FlushPolicy& everyLines(const uint32_t lineCount) {
+      _everyLines = lineCount;
+      return *this;
+    }
+
+    FlushPolicy& every(const std::chrono::milliseconds interval) {
+      _interval = interval;
+      return *this;
+    }
+
+    FlushPolicy& atLevel(const LogLevel level) {
+      _level = level;
+      return *this;
+    }
+
+//// Getter
+    [[nodiscard]] uint32_t everyLines() const {
+      return _everyLines;
+    }
+
+    [[nodiscard]] std::chrono::milliseconds every() const {
+      return _interval;
+    }
+
+    [[nodiscard]] bool flushesAt(const LogLevel level) const {
+      return level >= _level;
+    }
+
+  private:
+    uint32_t                  _everyLines = NO_LINE_LIMIT;
+    std::chrono::milliseconds _interval = NO_INTERVAL;
+    int                       _level = NO_LEVEL;
+  };
+
+} // namespace ulog
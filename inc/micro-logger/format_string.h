@@ -0,0 +1,150 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <utility>
+
+namespace ulog {
+
+  namespace format_error {
+    // Not constexpr: calling them from a consteval function makes the format string a build error,
+    // with their name in the compiler's message.
+    inline void unmatched_opening_brace_use_double_braces_for_a_literal_brace() {}
+    inline void unmatched_closing_brace_use_double_braces_for_a_literal_brace() {}
+    inline void only_empty_placeholders_are_supported() {}
+  }
+
+  // A format string literal, for `logger.info.fmt<"user={} took {}us">(id, us)`: checked and split
+  // at compile time. `{}` is replaced by the next argument, as written by `operator<<`; `{{` and
+  // `}}` are literal braces.
+  template <size_t N>
+  struct FormatString {
+    static constexpr size_t SIZE = N - 1; // without the terminating NUL
+
+    char text[N] {};
+
+    consteval FormatString(const char (&literal)[N]) { // NOLINT: implicit, from the literal
+      for (size_t index = 0; index < N; ++index) {
+        text[index] = literal[index];
+      }
+      static_cast<void>(placeholders()); // checks the format string
+    }
+
+    [[nodiscard]] consteval size_t placeholders() const {
+      size_t count = 0;
+      for (size_t index = 0; index < SIZE; ++index) {
+        if (text[index] == '{') {
+          if (index + 1 < SIZE && text[index + 1] == '{') {
+            ++index;
+          } else if (index + 1 < SIZE && text[index + 1] == '}') {
+            ++index;
+            ++count;
+          } else if (index + 1 < SIZE && text[index + 1] != '}') {
+            format_error::only_empty_placeholders_are_supported();
+          } else {
+            format_error::unmatched_opening_brace_use_double_braces_for_a_literal_brace();
+          }
+        } else if (text[index] == '}') {
+          if (index + 1 < SIZE && text[index + 1] == '}') {
+            ++index;
+          } else {
+            format_error::unmatched_closing_brace_use_double_braces_for_a_literal_brace();
+          }
+        }
+      }
+      return count;
+    }
+  };
+
+  // The literal segments around the placeholders of `Format`, with the escaped braces resolved:
+  // `segment<I>()` is what precedes the I-th argument (and `segment<ARGUMENTS>()` what follows the
+  // last one), a constant of known length.
+  template <FormatString Format>
+  class ParsedFormat {
+    struct Parsed {
+      char   literals[Format.SIZE + 1] {}; // the segments, back to back
+      size_t ends[Format.placeholders() + 1] {}; // end of each segment in `literals`
+    };
+
+    static constexpr Parsed PARSED = [] {
+      Parsed parsed;
+      size_t size = 0;
+      size_t segment = 0;
+      for (size_t index = 0; index < Format.SIZE; ++index) {
+        const char c = Format.text[index];
+        if ((c == '{' || c == '}') && Format.text[index + 1] == c) {
+          parsed.literals[size++] = c;
+          ++index;
+        } else if (c == '{') {
+          parsed.ends[segment++] = size;
+          ++index;
+        } else {
+          parsed.literals[size++] = c;
+        }
+      }
+      parsed.ends[segment] = size;
+      return parsed;
+    }();
+
+  public:
+    static constexpr size_t ARGUMENTS = Format.placeholders();
+
+    // Whether the segments have characters escaped in JSON strings (quotes, backslashes, control characters)
+    static constexpr bool NEEDS_JSON_ESCAPING = [] {
+      for (size_t index = 0; index < PARSED.ends[ARGUMENTS]; ++index) {
+        const auto c = static_cast<unsigned char>(PARSED.literals[index]);
+        if (c < 0x20 || c == '"' || c == '\\') {
+          return true;
+        }
+      }
+      return false;
+    }();
+
+    template <size_t I>
+    static constexpr std::string_view segment() {
+      static_assert(I <= ARGUMENTS);
+      constexpr size_t begin = I == 0 ? 0 : PARSED.ends[I - 1];
+      return std::string_view(PARSED.literals + begin, PARSED.ends[I] - begin);
+    }
+
+    // All the segments, in order: the literals of a binary format record.
+    static constexpr std::array<std::string_view, ARGUMENTS + 1> segments() {
+      return []<size_t... I>(std::index_sequence<I...>) {
+        return std::array<std::string_view, ARGUMENTS + 1>{segment<I>()...};
+      }(std::make_index_sequence<ARGUMENTS + 1>());
+    }
+  };
+
+} // namespace ulog
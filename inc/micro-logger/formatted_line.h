@@ -0,0 +1,90 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#include <string_view>
+
+#include "json_formatter.h"
+#include "line_prefix.h"
+#include "log_buffer.h"
+#include "log_level.h"
+
+namespace ulog {
+
+  // How a sink added with LoggerFactory::addSink renders the lines.
+  enum SinkFormat {
+    TEXT,       // as formatted by the factory (with ANSI escapes if it uses them)
+    PLAIN_TEXT, // without ANSI escapes
+    JSON_LINES  // one JSON object per line, see LoggerFactory::jsonMode
+  };
+
+  // A line formatted once as text by a LogMessageBuilder, with the bounds of its parts, from which
+  // each sink's rendering is derived: only the static prefix changes between text variants, and
+  // the JSON variant escapes the message and uses the fields formatted as JSON members.
+  struct FormattedLine {
+    std::string_view  text;       // "app time | LEVEL | name | message fields\n"
+    LogLevel          level;
+    const LinePrefix& prefix;
+    std::string_view  time;       // in `text`
+    std::string_view  message;    // in `text`, without the fields
+    std::string_view  jsonFields; // ",\"key\":value..."; empty unless a sink writes JSON lines
+
+    // `scratch` holds the rendering, unless it is `text` itself.
+    [[nodiscard]] std::string_view render(const SinkFormat format, LogBuffer& scratch) const {
+      switch (format) {
+        case TEXT:
+          return text;
+        case PLAIN_TEXT:
+          if (!prefix.hasAnsiEscapes()) {
+            return text;
+          }
+          scratch.append(prefix.plainBeforeTime());
+          scratch.append(time);
+          scratch.append(prefix.plainAfterTime());
+          scratch.append(text.substr(static_cast<size_t>(message.data() - text.data())));
+          return scratch.view();
+        case JSON_LINES:
+          scratch.append(std::string_view("{\"time\":\""));
+          scratch.append(time);
+          scratch.append('"');
+          scratch.append(prefix.jsonHeader());
+          JsonFormatter::appendEscaped(scratch, message);
+          scratch.append('"');
+          scratch.append(jsonFields);
+          scratch.append(std::string_view("}\n"));
+          return scratch.view();
+      }
+      return text; // unreachable, but don't remove - needed with GCC -Werror
+    }
+  };
+
+} // namespace ulog
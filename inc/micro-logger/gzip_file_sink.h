@@ -0,0 +1,312 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#if defined(_WIN32)
+#error "GzipFileSink is only available on POSIX platforms"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h> // link with -lz
+
+#include "log_sink.h"
+
+namespace ulog {
+
+  // Writes the logs to a gzip-compressed file, rotated by size. Requires zlib (-lz).
+  //
+  // The logging thread only copies the lines into a block of up to `blockSize` bytes; full blocks
+  // (and the current one, on `flush()`) are compressed and appended to the file by a background
+  // thread. Blocks are only cut between two `write` calls, which the LogWriter makes with whole
+  // lines, so no line is split between two gzip members or two files; a longer write is a block of
+  // its own. Each block is a gzip member of its own: the file is a valid .gz file at any block
+  // boundary (`zcat`, `zless`, `gunzip` read it whole). A crash loses the block being filled and
+  // the blocks waiting to be compressed: up to `(maxPendingBlocks + 1) * blockSize` bytes.
+  // Flushing often makes smaller blocks, which compress less: prefer e.g.
+  // `FlushPolicy().every(std::chrono::seconds(1))` to `alwaysFlush`.
+  //
+  // When `maxPendingBlocks` blocks are waiting for the background thread, the logging thread waits
+  // for it rather than dropping lines. The file is rotated once its compressed size would exceed
+  // `maxFileSize`: `app.log.gz` is renamed `app.log.1.gz` (most recent) to `app.log.<retainedFiles>.gz`,
+  // by the background thread. An existing file is appended to.
+  class GzipFileSink : public LogSink {
+  public:
+    static constexpr uint64_t DEFAULT_MAX_FILE_SIZE = 64 * 1024 * 1024;
+    static constexpr int DEFAULT_RETAINED_FILES = 5;
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 256 * 1024;
+    static constexpr size_t DEFAULT_MAX_PENDING_BLOCKS = 8;
+
+    explicit GzipFileSink(
+      std::string path,
+      const uint64_t maxFileSize = DEFAULT_MAX_FILE_SIZE,
+      const int retainedFiles = DEFAULT_RETAINED_FILES,
+      const int compressionLevel = Z_DEFAULT_COMPRESSION,
+      const size_t blockSize = DEFAULT_BLOCK_SIZE,
+      const size_t maxPendingBlocks = DEFAULT_MAX_PENDING_BLOCKS
+    ) : _path(std::move(path)),
+        _maxFileSize(maxFileSize),
+        _retainedFiles(retainedFiles),
+        _blockSize(std::max<size_t>(blockSize, 1)),
+        _maxPendingBlocks(std::max<size_t>(maxPendingBlocks, 1)) {
+      _current.reserve(_blockSize);
+      _deflateReady = ::deflateInit2(&_deflate, compressionLevel, Z_DEFLATED, GZIP_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+      openFile();
+      _thread = std::thread(&GzipFileSink::run, this);
+    }
+
+    GzipFileSink(const GzipFileSink&) = delete;
+    GzipFileSink& operator=(const GzipFileSink&) = delete;
+
+    ~GzipFileSink() override {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_current.empty()) {
+          _pending.push_back(std::move(_current));
+        }
+        _stopping = true;
+        _workCondition.notify_one();
+      }
+      _thread.join();
+
+      if (_deflateReady) {
+        ::deflateEnd(&_deflate);
+      }
+      if (_fd >= 0) {
+        ::close(_fd);
+      }
+    }
+
+    void write(const char* data, const size_t size) override {
+      std::unique_lock<std::mutex> lock(_mutex);
+      if (!_current.empty() && _current.size() + size > _blockSize) {
+        submit(lock);
+      }
+      _current.append(data, size);
+      if (_current.size() >= _blockSize) {
+        submit(lock);
+      }
+    }
+
+    // Hands the current block to the background thread; doesn't wait for it to be written.
+    void flush() override {
+      std::unique_lock<std::mutex> lock(_mutex);
+      if (!_current.empty()) {
+        submit(lock);
+      }
+    }
+
+    // Rotates the file before the next block.
+    void rotate() {
+      _rotationRequested.store(true, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint64_t droppedBytes() const {
+      return _droppedBytes.load(std::memory_order_relaxed);
+    }
+
+    // Of the lines given to the sink, and of what was written to the files so far
+    [[nodiscard]] uint64_t uncompressedBytes() const {
+      return _uncompressedBytes.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint64_t compressedBytes() const {
+      return _compressedBytes.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] const std::string& path() const {
+      return _path;
+    }
+
+  private:
+    static constexpr int GZIP_WINDOW_BITS = 15 + 16; // zlib's largest window, with a gzip header
+
+    std::string               _path;
+    uint64_t                  _maxFileSize;
+    int                       _retainedFiles;
+    size_t                    _blockSize;
+    size_t                    _maxPendingBlocks;
+
+    //// Shared with the background thread, under _mutex
+    std::mutex                _mutex;
+    std::condition_variable   _workCondition;
+    std::condition_variable   _spaceCondition;
+    std::string               _current;  // block being filled
+    std::deque<std::string>   _pending;  // blocks to compress
+    std::vector<std::string>  _spare;    // compressed blocks, to reuse
+    bool                      _stopping = false;
+
+    std::atomic<bool>         _rotationRequested{false};
+    std::atomic<uint64_t>     _droppedBytes{0};
+    std::atomic<uint64_t>     _uncompressedBytes{0};
+    std::atomic<uint64_t>     _compressedBytes{0};
+
+    //// Background thread
+    z_stream                  _deflate{};
+    bool                      _deflateReady = false;
+    std::vector<unsigned char> _compressed;
+    int                       _fd = -1;
+    uint64_t                  _fileSize = 0;
+
+    std::thread               _thread;
+
+//// Logging thread
+    void submit(std::unique_lock<std::mutex>& lock) {
+      _spaceCondition.wait(lock, [&] { return _pending.size() < _maxPendingBlocks; });
+      _pending.push_back(std::move(_current));
+      if (_spare.empty()) {
+        _current = std::string();
+        _current.reserve(_blockSize);
+      } else {
+        _current = std::move(_spare.back());
+        _spare.pop_back();
+      }
+      _workCondition.notify_one();
+    }
+
+//// Background thread
+    void run() {
+      std::unique_lock<std::mutex> lock(_mutex);
+      while (true) {
+        _workCondition.wait(lock, [&] { return _stopping || !_pending.empty(); });
+        if (_pending.empty()) {
+          return; // stopping, and everything is written
+        }
+        std::string block = std::move(_pending.front());
+        _pending.pop_front();
+        lock.unlock();
+
+        writeBlock(block);
+        block.clear();
+
+        lock.lock();
+        _spare.push_back(std::move(block));
+        _spaceCondition.notify_all();
+      }
+    }
+
+    // As a gzip member of its own
+    void writeBlock(const std::string& block) {
+      _uncompressedBytes.fetch_add(block.size(), std::memory_order_relaxed);
+      if (!_deflateReady || ::deflateReset(&_deflate) != Z_OK) {
+        _droppedBytes.fetch_add(block.size(), std::memory_order_relaxed);
+        return;
+      }
+      _compressed.resize(::deflateBound(&_deflate, static_cast<uLong>(block.size())));
+      _deflate.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(block.data()));
+      _deflate.avail_in = static_cast<uInt>(block.size());
+      _deflate.next_out = _compressed.data();
+      _deflate.avail_out = static_cast<uInt>(_compressed.size());
+      if (::deflate(&_deflate, Z_FINISH) != Z_STREAM_END) {
+        _droppedBytes.fetch_add(block.size(), std::memory_order_relaxed);
+        return;
+      }
+      const size_t size = _compressed.size() - _deflate.avail_out;
+
+      // Cleared whatever triggers the rotation, so that no request outlives it (an empty file
+      // doesn't need one)
+      const bool requested = _rotationRequested.exchange(false, std::memory_order_relaxed);
+      if (_fileSize > 0 && (_fileSize + size > _maxFileSize || requested)) {
+        rotateFile();
+      }
+      if (!writeAll(_compressed.data(), size)) {
+        _droppedBytes.fetch_add(block.size(), std::memory_order_relaxed);
+        return;
+      }
+      _fileSize += size;
+      _compressedBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    bool writeAll(const unsigned char* data, size_t size) const {
+      while (size > 0) {
+        const ssize_t written = _fd < 0 ? -1 : ::write(_fd, data, size);
+        if (written < 0 && errno == EINTR) {
+          continue;
+        }
+        if (written <= 0) {
+          return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+      }
+      return true;
+    }
+
+//// Files
+    void openFile() {
+      _fd = ::open(_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+      struct stat status {};
+      _fileSize = _fd >= 0 && ::fstat(_fd, &status) == 0 ? static_cast<uint64_t>(status.st_size) : 0;
+    }
+
+    // Shifts the names of the retained files, and starts a new one.
+    void rotateFile() {
+      if (_fd >= 0) {
+        ::close(_fd);
+      }
+      if (_retainedFiles > 0) {
+        std::remove(rotatedFilePath(_retainedFiles).c_str());
+        for (int index = _retainedFiles - 1; index >= 1; --index) {
+          std::rename(rotatedFilePath(index).c_str(), rotatedFilePath(index + 1).c_str());
+        }
+        std::rename(_path.c_str(), rotatedFilePath(1).c_str());
+      } else {
+        std::remove(_path.c_str());
+      }
+      openFile();
+    }
+
+    // "app.log.gz" -> "app.log.1.gz"
+    [[nodiscard]] std::string rotatedFilePath(const int index) const {
+      constexpr std::string_view EXTENSION = ".gz";
+      const bool gz = _path.size() > EXTENSION.size()
+        && _path.compare(_path.size() - EXTENSION.size(), EXTENSION.size(), EXTENSION) == 0;
+      const std::string base = gz ? _path.substr(0, _path.size() - EXTENSION.size()) : _path;
+      return base + "." + std::to_string(index) + (gz ? ".gz" : "");
+    }
+  };
+
+} // namespace ulog
@@ -0,0 +1,190 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ULOG_JSON_SSE2 1
+#endif
+
+#include "log_buffer.h"
+#include "log_level.h"
+
+namespace ulog {
+
+  // Writes JSON strings into a LogBuffer, for the JSON lines output mode (LoggerFactory::jsonMode).
+  //
+  // Text is copied in runs between the characters that need escaping ('"', '\\' and control
+  // characters); the runs are found 16 bytes at a time with SSE2 (8 bytes at a time elsewhere), so
+  // typical log text costs about the same as a plain copy. Bytes above 0x7F (UTF-8) are copied as-is.
+  class JsonFormatter {
+  public:
+    static void appendEscaped(LogBuffer& buffer, const std::string_view text) {
+      size_t start = 0;
+      for (;;) {
+        const size_t next = findEscaped(text.data(), text.size(), start);
+        buffer.append(text.data() + start, next - start);
+        if (next == text.size()) {
+          return;
+        }
+        appendEscapedCharacter(buffer, static_cast<unsigned char>(text[next]));
+        start = next + 1;
+      }
+    }
+
+    // Quoted and escaped
+    static void appendString(LogBuffer& buffer, const std::string_view text) {
+      buffer.append('"');
+      appendEscaped(buffer, text);
+      buffer.append('"');
+    }
+
+    static std::string_view levelName(const LogLevel level) {
+      switch (level) {
+        case DEBUG:   return "DEBUG";
+        case INFO:    return "INFO";
+        case WARNING: return "WARNING";
+        case ERROR:   return "ERROR";
+      }
+      return "UNKNOWN";
+    }
+
+    // The static fields of a logger's lines: `,"app":"...","logger":"..."` (no "app" if empty).
+    static std::string names(const std::string_view appName, const std::string_view loggerName) {
+      LogBuffer buffer;
+      if (!appName.empty()) {
+        buffer.append(std::string_view(",\"app\":"));
+        appendString(buffer, appName);
+      }
+      buffer.append(std::string_view(",\"logger\":"));
+      appendString(buffer, loggerName);
+      return std::string(buffer.view());
+    }
+
+    // What follows the timestamp in a line at `level`, up to the opening quote of the message:
+    // `,"level":"INFO","app":"...","logger":"...","msg":"`.
+    static std::string header(const LogLevel level, const std::string_view names) {
+      std::string header;
+      header.append(",\"level\":\"").append(levelName(level)).append("\"")
+            .append(names)
+            .append(",\"msg\":\"");
+      return header;
+    }
+
+    // Index of the first character of `data[start, size)` that needs escaping, or `size`.
+    static size_t findEscaped(const char* data, const size_t size, size_t start) {
+#if defined(ULOG_JSON_SSE2)
+      const __m128i quote = _mm_set1_epi8('"');
+      const __m128i backslash = _mm_set1_epi8('\\');
+      const __m128i lastControl = _mm_set1_epi8(0x1F);
+      for (; start + 16 <= size; start += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + start));
+        const __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(chunk, lastControl), chunk); // unsigned <= 0x1F
+        const __m128i special = _mm_or_si128(
+          control,
+          _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash))
+        );
+        const int mask = _mm_movemask_epi8(special);
+        if (mask != 0) {
+          return start + static_cast<size_t>(std::countr_zero(static_cast<unsigned>(mask)));
+        }
+      }
+#else
+      for (; start + 8 <= size; start += 8) {
+        uint64_t chunk;
+        std::memcpy(&chunk, data + start, sizeof(chunk));
+        if (mayNeedEscaping(chunk)) {
+          break; // located by the loop below
+        }
+      }
+#endif
+      for (; start < size; ++start) {
+        if (needsEscaping(static_cast<unsigned char>(data[start]))) {
+          return start;
+        }
+      }
+      return size;
+    }
+
+  private:
+    static bool needsEscaping(const unsigned char c) {
+      return c < 0x20 || c == '"' || c == '\\';
+    }
+
+#if !defined(ULOG_JSON_SSE2)
+    static constexpr uint64_t ONES = 0x0101010101010101ULL;
+    static constexpr uint64_t HIGH_BITS = 0x8080808080808080ULL;
+
+    // SWAR: true if one of the 8 bytes is below 0x20, '"' or '\\'.
+    static bool mayNeedEscaping(const uint64_t chunk) {
+      const auto hasLess = [](const uint64_t bytes, const uint64_t n) {
+        return (bytes - ONES * n) & ~bytes & HIGH_BITS;
+      };
+      const auto hasZero = [](const uint64_t bytes) {
+        return (bytes - ONES) & ~bytes & HIGH_BITS;
+      };
+      return (hasLess(chunk, 0x20) | hasZero(chunk ^ (ONES * '"')) | hasZero(chunk ^ (ONES * '\\'))) != 0;
+    }
+#endif
+
+    static void appendEscapedCharacter(LogBuffer& buffer, const unsigned char c) {
+      static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+      char* out = buffer.reserve(6);
+      out[0] = '\\';
+      switch (c) {
+        case '"':  out[1] = '"';  break;
+        case '\\': out[1] = '\\'; break;
+        case '\n': out[1] = 'n';  break;
+        case '\r': out[1] = 'r';  break;
+        case '\t': out[1] = 't';  break;
+        case '\b': out[1] = 'b';  break;
+        case '\f': out[1] = 'f';  break;
+        default:
+          out[1] = 'u';
+          out[2] = '0';
+          out[3] = '0';
+          out[4] = HEX_DIGITS[c >> 4];
+          out[5] = HEX_DIGITS[c & 0xF];
+          buffer.commit(6);
+          return;
+      }
+      buffer.commit(2);
+    }
+  };
+
+} // namespace ulog
@@ -0,0 +1,149 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace ulog {
+
+  // The static part of a LogStream's lines, built once by LoggerFactory::create and shared
+  // (immutable) by the copies of the stream.
+  //
+  // Text lines are "app time | LEVEL | name | message": everything but the time and the message is
+  // kept in one buffer, so the LogMessageBuilder writes a line's header with two appends around
+  // the timestamp. In JSON mode, `jsonHeader` is what follows the time (see JsonFormatter::header).
+  // The same buffer without ANSI escapes is kept as well, for sinks writing plain text.
+  class LinePrefix {
+  public:
+    static constexpr std::string_view SEPARATOR = " | ";
+
+    LinePrefix(
+      const std::string_view formattedAppName,
+      const std::string_view formattedLogLevel,
+      const std::string_view formattedLoggerName,
+      std::string jsonHeader = ""
+    ) : _appNameSize(formattedAppName.size()),
+        _logLevelSize(formattedLogLevel.size()),
+        _loggerNameSize(formattedLoggerName.size()),
+        _jsonHeader(std::move(jsonHeader)) {
+      _text.reserve(_appNameSize + _logLevelSize + _loggerNameSize + 3 * SEPARATOR.size());
+      _text.append(formattedAppName).append(SEPARATOR)
+           .append(formattedLogLevel).append(SEPARATOR)
+           .append(formattedLoggerName).append(SEPARATOR);
+      if (_text.find('\033') != std::string::npos) {
+        _plainAppNameSize = appendWithoutAnsiEscapes(_plainText, beforeTime());
+        appendWithoutAnsiEscapes(_plainText, afterTime());
+      }
+    }
+
+    static std::shared_ptr<const LinePrefix> make(
+      const std::string_view formattedAppName,
+      const std::string_view formattedLogLevel,
+      const std::string_view formattedLoggerName,
+      std::string jsonHeader = ""
+    ) {
+      return std::make_shared<const LinePrefix>(formattedAppName, formattedLogLevel, formattedLoggerName, std::move(jsonHeader));
+    }
+
+    // Same prefix, with another app name
+    [[nodiscard]] std::shared_ptr<const LinePrefix> withAppName(const std::string_view formattedAppName) const {
+      return make(formattedAppName, formattedLogLevel(), formattedLoggerName(), _jsonHeader);
+    }
+
+    // "app " (with its ANSI escapes, if any)
+    [[nodiscard]] std::string_view beforeTime() const {
+      return std::string_view(_text).substr(0, _appNameSize);
+    }
+
+    // " | LEVEL | name | "
+    [[nodiscard]] std::string_view afterTime() const {
+      return std::string_view(_text).substr(_appNameSize);
+    }
+
+    [[nodiscard]] bool hasAnsiEscapes() const {
+      return !_plainText.empty();
+    }
+
+    // Without ANSI escapes
+    [[nodiscard]] std::string_view plainBeforeTime() const {
+      return _plainText.empty() ? beforeTime() : std::string_view(_plainText).substr(0, _plainAppNameSize);
+    }
+
+    [[nodiscard]] std::string_view plainAfterTime() const {
+      return _plainText.empty() ? afterTime() : std::string_view(_plainText).substr(_plainAppNameSize);
+    }
+
+    [[nodiscard]] const std::string& jsonHeader() const {
+      return _jsonHeader;
+    }
+
+    [[nodiscard]] std::string_view formattedAppName() const {
+      return beforeTime();
+    }
+
+    [[nodiscard]] std::string_view formattedLogLevel() const {
+      return std::string_view(_text).substr(_appNameSize + SEPARATOR.size(), _logLevelSize);
+    }
+
+    [[nodiscard]] std::string_view formattedLoggerName() const {
+      return std::string_view(_text).substr(_appNameSize + _logLevelSize + 2 * SEPARATOR.size(), _loggerNameSize);
+    }
+
+  private:
+    std::string _text;
+    size_t      _appNameSize;
+    size_t      _logLevelSize;
+    size_t      _loggerNameSize;
+    std::string _jsonHeader;
+    std::string _plainText; // empty if `_text` has no ANSI escapes
+    size_t      _plainAppNameSize = 0;
+
+    // Drops the CSI sequences ("\033[", parameters, final byte), e.g. "\033[31;1m"
+    static size_t appendWithoutAnsiEscapes(std::string& out, const std::string_view text) {
+      const size_t before = out.size();
+      for (size_t index = 0; index < text.size(); ++index) {
+        if (text[index] == '\033' && index + 1 < text.size() && text[index + 1] == '[') {
+          index += 2;
+          while (index < text.size() && (text[index] < '@' || text[index] > '~')) {
+            ++index;
+          }
+          continue;
+        }
+        out.push_back(text[index]);
+      }
+      return out.size() - before;
+    }
+  };
+
+} // namespace ulog
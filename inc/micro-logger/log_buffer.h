@@ -0,0 +1,235 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string_view>
+
+namespace ulog {
+
+  // Byte buffer a log line is formatted into.
+  //
+  // The first INLINE_CAPACITY bytes live inside the object (i.e. on the logging thread's stack), so
+  // a typical line is formatted without any heap allocation; longer lines spill to the heap.
+  class LogBuffer {
+  public:
+    static constexpr size_t INLINE_CAPACITY = 512;
+
+    LogBuffer() : _data(_inline), _size(0), _capacity(INLINE_CAPACITY) {
+      // empty
+    }
+
+    LogBuffer(const LogBuffer&) = delete;
+    LogBuffer& operator=(const LogBuffer&) = delete;
+
+    LogBuffer(LogBuffer&& other) noexcept : LogBuffer() {
+      moveFrom(other);
+    }
+
+    LogBuffer& operator=(LogBuffer&& other) noexcept {
+      if (this != &other) {
+        _heap.reset();
+        _data = _inline;
+        _capacity = INLINE_CAPACITY;
+        moveFrom(other);
+      }
+      return *this;
+    }
+
+    void append(const char* data, const size_t size) {
+      std::memcpy(reserve(size), data, size);
+      _size += size;
+    }
+
+    void append(const std::string_view data) {
+      append(data.data(), data.size());
+    }
+
+    void append(const char c) {
+      if (_size == _capacity) {
+        grow(1);
+      }
+      _data[_size++] = c;
+    }
+
+    // Returns room for at least `size` bytes at the end; `commit()` what was actually written.
+    char* reserve(const size_t size) {
+      if (_capacity - _size < size) {
+        grow(size);
+      }
+      return _data + _size;
+    }
+
+    void commit(const size_t size) {
+      _size += size;
+    }
+
+    void clear() {
+      _size = 0;
+    }
+
+    [[nodiscard]] const char* data() const {
+      return _data;
+    }
+
+    [[nodiscard]] size_t size() const {
+      return _size;
+    }
+
+    [[nodiscard]] std::string_view view() const {
+      return {_data, _size};
+    }
+
+  private:
+    char                    _inline[INLINE_CAPACITY];
+    std::unique_ptr<char[]> _heap;
+    char*                   _data;
+    size_t                  _size;
+    size_t                  _capacity;
+
+    void grow(const size_t extra) {
+      size_t capacity = _capacity * 2;
+      while (capacity - _size < extra) {
+        capacity *= 2;
+      }
+      std::unique_ptr<char[]> heap(new char[capacity]);
+      std::memcpy(heap.get(), _data, _size);
+      _heap = std::move(heap);
+      _data = _heap.get();
+      _capacity = capacity;
+    }
+
+    void moveFrom(LogBuffer& other) {
+      if (other._heap != nullptr) {
+        _heap = std::move(other._heap);
+        _data = _heap.get();
+        _capacity = other._capacity;
+      } else {
+        std::memcpy(_inline, other._inline, other._size);
+      }
+      _size = other._size;
+
+      other._data = other._inline;
+      other._size = 0;
+      other._capacity = INLINE_CAPACITY;
+    }
+  };
+
+  // std::ostream appending to a LogBuffer, for values that only have an `operator<<(std::ostream&)`.
+  //
+  // Constructing a std::ostream for every line is expensive, so each thread keeps one and points it
+  // at the buffer being formatted. Its formatting state (std::hex, std::setprecision...) is reset
+  // when a line starts using it, so it only lasts for one line as before.
+  class LogBufferStream {
+  public:
+    // Points the thread's stream at `buffer` until the Target is destroyed.
+    class Target {
+    public:
+      Target(LogBufferStream& stream, LogBuffer& buffer, const bool newLine)
+          : _stream(stream), _previous(stream._streambuf.target(&buffer)) {
+        if (newLine) {
+          _stream._ostream.copyfmt(defaultFormat());
+          _stream._ostream.clear();
+        }
+      }
+
+      Target(const Target&) = delete;
+      Target& operator=(const Target&) = delete;
+
+      ~Target() {
+        _stream._streambuf.target(_previous);
+      }
+
+      [[nodiscard]] std::ostream& stream() const {
+        return _stream._ostream;
+      }
+
+    private:
+      LogBufferStream& _stream;
+      LogBuffer*       _previous;
+    };
+
+    static LogBufferStream& forThisThread() {
+      thread_local LogBufferStream stream;
+      return stream;
+    }
+
+    // True if the formatting state was changed (e.g. by std::hex) since the current line started.
+    [[nodiscard]] bool formatChanged() const {
+      return _ostream.flags() != defaultFormat().flags()
+          || _ostream.precision() != defaultFormat().precision()
+          || _ostream.width() != 0
+          || _ostream.fill() != defaultFormat().fill();
+    }
+
+  private:
+    class Streambuf : public std::streambuf {
+    public:
+      LogBuffer* target(LogBuffer* buffer) {
+        LogBuffer* previous = _buffer;
+        _buffer = buffer;
+        return previous;
+      }
+
+    protected:
+      int_type overflow(const int_type c) override {
+        if (_buffer != nullptr && !traits_type::eq_int_type(c, traits_type::eof())) {
+          _buffer->append(traits_type::to_char_type(c));
+        }
+        return traits_type::not_eof(c);
+      }
+
+      std::streamsize xsputn(const char* s, const std::streamsize n) override {
+        if (_buffer != nullptr) {
+          _buffer->append(s, static_cast<size_t>(n));
+        }
+        return n;
+      }
+
+    private:
+      LogBuffer* _buffer = nullptr;
+    };
+
+    Streambuf          _streambuf;
+    std::ostream       _ostream{&_streambuf};
+
+    static const std::ostream& defaultFormat() {
+      thread_local const std::ostream format{nullptr};
+      return format;
+    }
+  };
+
+} // namespace ulog
@@ -0,0 +1,296 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define ULOG_CYCLE_COUNTER_X86
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define ULOG_CYCLE_COUNTER_X86
+#elif defined(__aarch64__)
+#define ULOG_CYCLE_COUNTER_ARM64
+#endif
+
+namespace ulog {
+
+  // Where the LogStreams take the timestamps of their lines from (see LoggerFactory::clock), called
+  // on the logging thread for every line; without one, std::chrono::system_clock::now().
+  class LogClock {
+  public:
+    virtual ~LogClock() = default;
+
+    [[nodiscard]] virtual std::chrono::system_clock::time_point now() = 0;
+  };
+
+  // Reads the CPU's cycle counter (rdtsc on x86 when the TSC is invariant, CNTVCT_EL0 on ARM64; else
+  // std::chrono::steady_clock), and converts it to wall-clock time with a multiply-add. The counter's
+  // rate is measured against std::chrono::steady_clock, and the offset taken from
+  // std::chrono::system_clock, by a background thread shared by all the TscClocks of the process:
+  // `INITIAL_CALIBRATION` after the first one is created, then every `CALIBRATION_INTERVAL`. The
+  // timestamps follow the system clock, steps included, give or take the calibration error
+  // (typically well under a microsecond); until the first calibration, `now()` returns
+  // std::chrono::system_clock::now(). Resolution is that of the counter: nanoseconds are meaningful.
+  //
+  // Reading the clock takes no lock (the calibration is published with a sequence number), but it
+  // is not free: the counter read itself takes a few dozen cycles on bare metal, and over 20ns in
+  // some virtual machines, where it is hardly faster than the system clock. bench/timestamp_bench
+  // measures both on the machine at hand.
+  class TscClock : public LogClock {
+  public:
+    static constexpr auto CALIBRATION_INTERVAL = std::chrono::milliseconds(1000);
+    static constexpr auto INITIAL_CALIBRATION = std::chrono::milliseconds(10);
+
+    TscClock() : _calibrator(Calibrator::shared()) {
+      // empty
+    }
+
+    [[nodiscard]] std::chrono::system_clock::time_point now() override {
+      std::chrono::system_clock::time_point time;
+      return _calibrator->convert(ticks(), time) ? time : std::chrono::system_clock::now();
+    }
+
+    // The raw counter, for toTime(): `now()` in two steps, e.g. to convert off the hot path.
+    [[nodiscard]] uint64_t ticks() const {
+      return _calibrator->cycleCounter ? readCycleCounter() : steadyTicks();
+    }
+
+    // Waits for the first calibration if needed.
+    [[nodiscard]] std::chrono::system_clock::time_point toTime(const uint64_t ticks) const {
+      std::chrono::system_clock::time_point time;
+      while (!_calibrator->convert(ticks, time)) {
+        _calibrator->waitForCalibration();
+      }
+      return time;
+    }
+
+    void waitForCalibration() const {
+      _calibrator->waitForCalibration();
+    }
+
+    // False if `ticks()` falls back to std::chrono::steady_clock.
+    [[nodiscard]] bool usesCycleCounter() const {
+      return _calibrator->cycleCounter;
+    }
+
+    // 0 until the first calibration.
+    [[nodiscard]] double nanosecondsPerTick() const {
+      return _calibrator->nanosecondsPerTick.load(std::memory_order_relaxed);
+    }
+
+  private:
+    struct Sample {
+      int64_t ticks;
+      int64_t steadyNanoseconds;
+      int64_t systemNanoseconds; // since the epoch
+    };
+
+    static constexpr int SAMPLE_ATTEMPTS = 8;
+
+    // The calibration shared by the TscClocks, and the thread updating it while any of them exists.
+    class Calibrator {
+    public:
+      const bool                cycleCounter = hasCycleCounter();
+
+      alignas(64) std::atomic<uint64_t> sequence{0}; // odd while the calibration is updated, 0 before the first
+      std::atomic<int64_t>      baseTicks{0};
+      std::atomic<int64_t>      baseNanoseconds{0};
+      std::atomic<double>       nanosecondsPerTick{0.0};
+
+      static std::shared_ptr<Calibrator> shared() {
+        static std::mutex mutex;
+        static std::weak_ptr<Calibrator> current;
+        std::lock_guard<std::mutex> lock(mutex);
+        std::shared_ptr<Calibrator> calibrator = current.lock();
+        if (calibrator == nullptr) {
+          calibrator = std::make_shared<Calibrator>();
+          current = calibrator;
+        }
+        return calibrator;
+      }
+
+      Calibrator() : _start(sample(cycleCounter)), _thread(&Calibrator::run, this) {
+        // empty
+      }
+
+      Calibrator(const Calibrator&) = delete;
+      Calibrator& operator=(const Calibrator&) = delete;
+
+      ~Calibrator() {
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          _stopping = true;
+        }
+        _condition.notify_all();
+        _thread.join();
+      }
+
+      // False before the first calibration.
+      bool convert(const uint64_t ticks, std::chrono::system_clock::time_point& time) const {
+        uint64_t sequenceBefore;
+        int64_t ticksBase;
+        int64_t nanosecondsBase;
+        double rate;
+        do {
+          sequenceBefore = sequence.load(std::memory_order_acquire);
+          ticksBase = baseTicks.load(std::memory_order_relaxed);
+          nanosecondsBase = baseNanoseconds.load(std::memory_order_relaxed);
+          rate = nanosecondsPerTick.load(std::memory_order_relaxed);
+          std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((sequenceBefore & 1) != 0 || sequenceBefore != sequence.load(std::memory_order_relaxed));
+        if (sequenceBefore == 0) {
+          return false;
+        }
+
+        const auto elapsed = static_cast<double>(static_cast<int64_t>(ticks) - ticksBase) * rate;
+        time = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          std::chrono::nanoseconds(nanosecondsBase + static_cast<int64_t>(elapsed))
+        ));
+        return true;
+      }
+
+      void waitForCalibration() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _condition.wait(lock, [&] { return sequence.load(std::memory_order_relaxed) != 0; });
+      }
+
+    private:
+      Sample                    _start; // background thread only
+
+      std::mutex                _mutex;
+      std::condition_variable   _condition;
+      bool                      _stopping = false; // under _mutex
+      std::thread               _thread;
+
+      void run() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        std::chrono::milliseconds interval = INITIAL_CALIBRATION;
+        while (!_condition.wait_for(lock, interval, [&] { return _stopping; })) {
+          calibrate(sample(cycleCounter));
+          _condition.notify_all();
+          interval = CALIBRATION_INTERVAL;
+        }
+      }
+
+      // The rate is measured since the first sample, the longest baseline; the offset makes the
+      // latest sample exact.
+      void calibrate(const Sample& end) {
+        if (end.ticks <= _start.ticks) {
+          return;
+        }
+        const double rate = static_cast<double>(end.steadyNanoseconds - _start.steadyNanoseconds)
+                          / static_cast<double>(end.ticks - _start.ticks);
+        const uint64_t sequenceBefore = sequence.load(std::memory_order_relaxed);
+        sequence.store(sequenceBefore + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        baseTicks.store(end.ticks, std::memory_order_relaxed);
+        baseNanoseconds.store(end.systemNanoseconds, std::memory_order_relaxed);
+        nanosecondsPerTick.store(rate, std::memory_order_relaxed);
+        sequence.store(sequenceBefore + 2, std::memory_order_release);
+      }
+    };
+
+    std::shared_ptr<Calibrator> _calibrator;
+
+    // A reading of the three clocks, keeping the attempt with the two counter reads closest to
+    // each other.
+    static Sample sample(const bool cycleCounter) {
+      const auto ticks = [&] { return static_cast<int64_t>(cycleCounter ? readCycleCounter() : steadyTicks()); };
+      Sample best{};
+      int64_t bestWindow = INT64_MAX;
+      for (int i = 0; i < SAMPLE_ATTEMPTS; ++i) {
+        const auto before = ticks();
+        const auto steadyTime = std::chrono::steady_clock::now();
+        const auto systemTime = std::chrono::system_clock::now();
+        const auto after = ticks();
+        if (after - before < bestWindow) {
+          bestWindow = after - before;
+          best.ticks = before + (after - before) / 2;
+          best.steadyNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(steadyTime.time_since_epoch()).count();
+          best.systemNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(systemTime.time_since_epoch()).count();
+        }
+      }
+      return best;
+    }
+
+    static uint64_t steadyTicks() {
+      return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+      ).count());
+    }
+
+    static uint64_t readCycleCounter() {
+#if defined(ULOG_CYCLE_COUNTER_X86)
+      return __rdtsc();
+#elif defined(ULOG_CYCLE_COUNTER_ARM64)
+      uint64_t ticks;
+      asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+      return ticks;
+#else
+      return steadyTicks();
+#endif
+    }
+
+    // The TSC only counts at a constant rate across cores and power states if it's invariant.
+    static bool hasCycleCounter() {
+#if defined(ULOG_CYCLE_COUNTER_X86) && defined(_MSC_VER)
+      int registers[4];
+      __cpuid(registers, 0x80000000);
+      if (static_cast<unsigned>(registers[0]) < 0x80000007) {
+        return false;
+      }
+      __cpuid(registers, 0x80000007);
+      return (registers[3] & (1 << 8)) != 0;
+#elif defined(ULOG_CYCLE_COUNTER_X86)
+      unsigned eax, ebx, ecx, edx;
+      if (__get_cpuid_max(0x80000000, nullptr) < 0x80000007 || !__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+        return false;
+      }
+      return (edx & (1u << 8)) != 0;
+#elif defined(ULOG_CYCLE_COUNTER_ARM64)
+      return true; // the generic timer has a fixed frequency
+#else
+      return false;
+#endif
+    }
+  };
+
+} // namespace ulog
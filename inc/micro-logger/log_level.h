@@ -0,0 +1,56 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+// Compile-time ceiling: statements below this level written with the ULOG_DEBUG(logger)-style
+// macros (see logger.h) compile down to nothing, without evaluating their operands, e.g.
+// `-DULOG_ACTIVE_LEVEL=ULOG_LEVEL_INFO` for release builds.
+#define ULOG_LEVEL_DEBUG   0
+#define ULOG_LEVEL_INFO    1
+#define ULOG_LEVEL_WARNING 2
+#define ULOG_LEVEL_ERROR   3
+#define ULOG_LEVEL_OFF     4
+
+#ifndef ULOG_ACTIVE_LEVEL
+#define ULOG_ACTIVE_LEVEL ULOG_LEVEL_DEBUG
+#endif
+
+namespace ulog {
+
+  enum LogLevel {
+    DEBUG   = ULOG_LEVEL_DEBUG,
+    INFO    = ULOG_LEVEL_INFO,
+    WARNING = ULOG_LEVEL_WARNING,
+    ERROR   = ULOG_LEVEL_ERROR
+  };
+
+} // namespace ulog
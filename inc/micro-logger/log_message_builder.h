@@ -31,115 +31,539 @@ SOFTWARE.
 
 #pragma once
 
+#include <chrono>
+#include <cmath>
+#include <concepts>
 #include <string>
-#include <sstream>
-#include <mutex>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 
-#include "logs_observer.h"
+#include "binary_log.h"
+#include "format_string.h"
+#include "json_formatter.h"
+#include "line_prefix.h"
+#include "log_buffer.h"
+#include "log_level.h"
+#include "log_writer.h"
+#include "timestamp_cache.h"
+#include "value_formatter.h"
 
 namespace ulog {
 
+  // Callable producing a value to log, only called if the line is written (see LogMessageBuilder).
+  template <typename F>
+  concept LazyValue = std::invocable<const F&> && !std::is_void_v<std::invoke_result_t<const F&>>;
+
   class LogMessageBuilder {
   public:
-    LogMessageBuilder(
-      std::ostream& stream,
-      const bool alwaysFlush,
-      LogsObserver* callback,
-      std::string formattedTime,
-      std::string formattedAppName,
-      std::string formattedLogLevel,
-      std::string formattedLoggerName,
-      std::mutex* streamMutex,
-      std::mutex* callbackMutex
-    ) : _stream(&stream),
-        _alwaysFlush(alwaysFlush),
-        _callback(callback),
-        _formattedTime(std::move(formattedTime)),
-        _formattedAppName(std::move(formattedAppName)),
-        _formattedLogLevel(std::move(formattedLogLevel)),
-        _formattedLoggerName(std::move(formattedLoggerName)),
-        _streamMutex(streamMutex),
-        _callbackMutex(callbackMutex) {
+    // Discards everything, e.g. for a line below the minimum level.
+    LogMessageBuilder() : _writer(nullptr) {
       // empty
     }
 
+    // Writes the line's header ("app time | LEVEL | name | ") straight into the buffer; in JSON
+    // mode, opens the line's object up to the message. With `recordOnly`, the line is below the
+    // minimum level, and only goes to the writer's FlightRecorder.
+    LogMessageBuilder(
+      LogWriter* writer,
+      const LogLevel level,
+      const std::chrono::system_clock::time_point time,
+      const TimestampPrecision timestampPrecision,
+      const LinePrefix& prefix,
+      const bool recordOnly = false
+    ) : _writer(writer),
+        _level(level),
+        _json(writer->json()),
+        _recordOnly(recordOnly),
+        _routedPrefix(writer->routed() ? &prefix : nullptr),
+        _routedJson(writer->routedJson()) {
+      _buffer.append(_json ? JSON_TIME_KEY : prefix.beforeTime());
+      _timeStart = _buffer.size();
+      _buffer.commit(TimestampCache::format(
+        time, timestampPrecision, _buffer.reserve(TimestampCache::MAX_FORMATTED_SIZE)
+      ));
+      _timeEnd = _buffer.size();
+      if (_json) {
+        _buffer.append('"');
+        _buffer.append(prefix.jsonHeader());
+      } else {
+        _buffer.append(prefix.afterTime());
+      }
+      _messageStart = _buffer.size();
+    }
+
+    // Binary mode: starts a BinaryLog record; the header is only referenced by its site ID.
+    LogMessageBuilder(
+      LogWriter* writer,
+      const LogLevel level,
+      const std::chrono::system_clock::time_point time,
+      const uint32_t siteId
+    ) : _writer(writer),
+        _level(level),
+        _binary(true) {
+      BinaryLog::beginMessage(
+        _buffer, siteId,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count()
+      );
+      _messageStart = _buffer.size();
+    }
+
     LogMessageBuilder(LogMessageBuilder&& other) noexcept
-        : _stream(other._stream),
-          _alwaysFlush(other._alwaysFlush),
-          _callback(other._callback),
-          _formattedTime(std::move(other._formattedTime)),
-          _formattedAppName(std::move(other._formattedAppName)),
-          _formattedLogLevel(std::move(other._formattedLogLevel)),
-          _formattedLoggerName(std::move(other._formattedLoggerName)),
-          _ss(std::move(other._ss)),
-          _streamMutex(other._streamMutex),
-          _callbackMutex(other._callbackMutex) {}
+        : _writer(other._writer),
+          _level(other._level),
+          _binary(other._binary),
+          _json(other._json),
+          _recordOnly(other._recordOnly),
+          _routedPrefix(other._routedPrefix),
+          _routedJson(other._routedJson),
+          _buffer(std::move(other._buffer)),
+          _timeStart(other._timeStart),
+          _timeEnd(other._timeEnd),
+          _messageStart(other._messageStart),
+          _fields(std::move(other._fields)),
+          _jsonFields(std::move(other._jsonFields)),
+          _usedStream(other._usedStream) {
+      other._writer = nullptr;
+    }
 
     LogMessageBuilder& operator=(LogMessageBuilder&& other) noexcept {
       if (this != &other) {
-        _stream = other._stream;
-        _alwaysFlush = other._alwaysFlush;
-        _callback = other._callback;
-        _formattedTime = std::move(other._formattedTime);
-        _formattedAppName = std::move(other._formattedAppName);
-        _formattedLogLevel = std::move(other._formattedLogLevel);
-        _formattedLoggerName = std::move(other._formattedLoggerName);
-        _ss = std::move(other._ss);
-        _streamMutex = other._streamMutex;
-        _callbackMutex = other._callbackMutex;
+        _writer = other._writer;
+        _level = other._level;
+        _binary = other._binary;
+        _json = other._json;
+        _recordOnly = other._recordOnly;
+        _routedPrefix = other._routedPrefix;
+        _routedJson = other._routedJson;
+        _buffer = std::move(other._buffer);
+        _timeStart = other._timeStart;
+        _timeEnd = other._timeEnd;
+        _messageStart = other._messageStart;
+        _fields = std::move(other._fields);
+        _jsonFields = std::move(other._jsonFields);
+        _usedStream = other._usedStream;
+        other._writer = nullptr;
       }
       return *this;
     }
 
     ~LogMessageBuilder() {
-      std::stringstream log;
-      log << _formattedAppName << _formattedTime << " | " << _formattedLogLevel << " | " << _formattedLoggerName << " | " << _ss.str() << std::endl;
-      const std::string logMessage = log.str();
-
-      if (_streamMutex != nullptr) {
-        std::lock_guard<std::mutex> lock(*_streamMutex);
-        (*_stream) << logMessage;
-        if (_alwaysFlush) {
-          _stream->flush();
+      if (_writer == nullptr) {
+        return; // discarded or moved-from
+      }
+
+      if (_json) {
+        _buffer.append('"');
+        _buffer.append(_fields.view());
+        _buffer.append(std::string_view("}\n"));
+      } else {
+        // Fields start with a separating space, unless the message is empty
+        const auto fields = _fields.size() > 0 && _buffer.size() == _messageStart
+          ? _fields.view().substr(1)
+          : _fields.view();
+        if (_binary) {
+          if (!fields.empty()) {
+            BinaryLog::appendText(_buffer, fields);
+          }
+          BinaryLog::endMessage(_buffer, 0);
+        } else {
+          const size_t messageEnd = _buffer.size();
+          _buffer.append(fields);
+          _buffer.append('\n');
+          if (_routedPrefix != nullptr) {
+            writeRouted(messageEnd);
+            return;
+          }
         }
+      }
+      if (_recordOnly) {
+        _writer->record(_buffer.view(), _level);
+      } else if (_binary) {
+        _writer->write(_buffer.view(), _level);
       } else {
-        (*_stream) << logMessage;
-        if (_alwaysFlush) {
-          _stream->flush();
+        _writer->write(_buffer.view(), _level, _buffer.view().substr(_timeStart, _timeEnd - _timeStart));
+      }
+    }
+
+    // Adds a typed key-value field to the line, whatever the order of the `kv` and `<<` calls:
+    // written after the message, as ` key=value` in text and binary mode, and as a `"key":value`
+    // member of the line's object in JSON mode. Numbers and booleans are written as-is, strings
+    // (and anything else, formatted with std::ostream) quoted and escaped. A LazyValue is only
+    // called if the line is written.
+    template <typename T>
+    LogMessageBuilder& kv(const std::string_view key, const T& value) {
+      if (_writer == nullptr) {
+        return *this;
+      }
+      if constexpr (LazyValue<T>) {
+        return kv(key, value());
+      } else {
+        appendField(_fields, _json, key, value);
+        if (_routedJson) {
+          appendField(_jsonFields, true, key, value);
         }
+        return *this;
+      }
+    }
+
+    // Appends the format string with its `{}` placeholders replaced by `args`, each written as by
+    // `operator<<`: `line.fmt<"user={} took {}us">(id, us)`. The format string is checked and
+    // split at compile time, and a wrong number of arguments doesn't build.
+    template <FormatString Format, typename... Args>
+    LogMessageBuilder& fmt(const Args&... args) {
+      static_assert(sizeof...(Args) == ParsedFormat<Format>::ARGUMENTS,
+                    "the number of arguments must match the number of {} placeholders");
+      if (_writer != nullptr) {
+        appendFormatted<Format>(std::index_sequence_for<Args...>(), args...);
+      }
+      return *this;
+    }
+
+    // Fallback for any type with an `operator<<(std::ostream&, const T&)`
+    template <typename T>
+    LogMessageBuilder& operator<<(const T& message) {
+      if (_writer != nullptr) {
+        insertIntoStream(message);
       }
+      return *this;
+    }
+
+    // Lazy operands: `logger.debug << [&] { return summarize(state); }` only calls the lambda if
+    // the line is written, i.e. not for a discarded line (below the minimum level, throttled by a
+    // ULOG_EVERY_N-style macro...). A lambda taking the builder can write several parts:
+    // `logger.debug << [&](ulog::LogMessageBuilder& line) { line << a << ", " << b; }`.
+    template <typename F>
+      requires LazyValue<F>
+    LogMessageBuilder& operator<<(const F& message) {
+      if (_writer != nullptr) {
+        *this << message();
+      }
+      return *this;
+    }
 
-      if (_callback != nullptr) {
-        if (_callbackMutex != nullptr) {
-          std::lock_guard<std::mutex> lock(*_callbackMutex);
-          _callback->onOutputLogMessage(logMessage);
+    template <typename F>
+      requires std::invocable<const F&, LogMessageBuilder&>
+    LogMessageBuilder& operator<<(const F& message) {
+      if (_writer != nullptr) {
+        message(*this);
+      }
+      return *this;
+    }
+
+    //// Fast paths, formatted without std::ostream (unless a manipulator was used in the line)
+    template <typename T>
+      requires ValueFormatter::isInteger<T>
+    LogMessageBuilder& operator<<(const T& message) {
+      if (_writer != nullptr) {
+        if (formatChanged()) {
+          insertIntoStream(message);
+        } else {
+          appendInteger(message);
+        }
+      }
+      return *this;
+    }
+
+    template <typename T>
+      requires std::is_floating_point_v<T>
+    LogMessageBuilder& operator<<(const T& message) {
+      if (_writer != nullptr) {
+        if (formatChanged()) {
+          insertIntoStream(message);
         } else {
-          _callback->onOutputLogMessage(logMessage);
+          appendFloatingPoint(message);
         }
       }
+      return *this;
     }
 
+    // Any object pointer; character pointers are printed as strings, like std::ostream does
     template <typename T>
+      requires std::is_pointer_v<T> && std::is_object_v<std::remove_pointer_t<T>>
     LogMessageBuilder& operator<<(const T& message) {
-      _ss << message;
+      using Pointee = std::remove_cv_t<std::remove_pointer_t<T>>;
+      if constexpr (std::is_same_v<Pointee, char>) {
+        return *this << static_cast<const char*>(message);
+      } else if constexpr (ValueFormatter::isCharacter<Pointee>) {
+        if (_writer != nullptr) {
+          insertIntoStream(message);
+        }
+      } else if (_writer != nullptr) {
+        if (formatChanged()) {
+          insertIntoStream(message);
+        } else {
+          appendPointer(message);
+        }
+      }
+      return *this;
+    }
+
+    template <typename Rep, typename Period>
+    LogMessageBuilder& operator<<(const std::chrono::duration<Rep, Period>& message) {
+      if (_writer != nullptr) {
+        if (_binary) {
+          LogBuffer text;
+          ValueFormatter::appendDuration(text, message);
+          BinaryLog::appendText(_buffer, text.view());
+        } else {
+          ValueFormatter::appendDuration(_buffer, message);
+        }
+      }
+      return *this;
+    }
+
+    LogMessageBuilder& operator<<(const char* message) {
+      return *this << std::string_view(message != nullptr ? message : "(null)");
+    }
+
+    LogMessageBuilder& operator<<(const std::string& message) {
+      return *this << std::string_view(message);
+    }
+
+    LogMessageBuilder& operator<<(const std::string_view message) {
+      if (_writer != nullptr) {
+        if (formatChanged()) {
+          insertIntoStream(message);
+        } else {
+          appendText(message);
+        }
+      }
       return *this;
     }
 
+    LogMessageBuilder& operator<<(const char message) {
+      if (_writer != nullptr) {
+        if (formatChanged()) {
+          insertIntoStream(message);
+        } else {
+          appendText(std::string_view(&message, 1));
+        }
+      }
+      return *this;
+    }
+
+    LogMessageBuilder& operator<<(const signed char message) {
+      return *this << static_cast<char>(message);
+    }
+
+    LogMessageBuilder& operator<<(const unsigned char message) {
+      return *this << static_cast<char>(message);
+    }
+
+    LogMessageBuilder& operator<<(const bool message) {
+      if (_writer != nullptr) {
+        if (formatChanged()) {
+          insertIntoStream(message);
+        } else {
+          appendBool(message);
+        }
+      }
+      return *this;
+    }
+
+    static std::string formatLine(
+      const LinePrefix& prefix,
+      const std::string_view formattedTime,
+      const std::string_view message
+    ) {
+      std::string line;
+      line.reserve(prefix.beforeTime().size() + formattedTime.size() + prefix.afterTime().size() + message.size() + 1);
+      line.append(prefix.beforeTime()).append(formattedTime).append(prefix.afterTime())
+          .append(message).append(1, '\n');
+      return line;
+    }
+
+    static std::string formatJsonLine(
+      const LinePrefix& prefix,
+      const std::string_view formattedTime,
+      const std::string_view message
+    ) {
+      LogBuffer line;
+      line.append(JSON_TIME_KEY);
+      line.append(formattedTime);
+      line.append('"');
+      line.append(prefix.jsonHeader());
+      JsonFormatter::appendEscaped(line, message);
+      line.append(std::string_view("\"}\n"));
+      return std::string(line.view());
+    }
+
   private:
-    std::ostream*     _stream;
-    bool              _alwaysFlush;
+    static constexpr std::string_view JSON_TIME_KEY = "{\"time\":\"";
+
+    LogWriter*        _writer;
+    LogLevel          _level = DEBUG;
+    bool              _binary = false;
+    bool              _json = false;
+    bool              _recordOnly = false;
+    const LinePrefix* _routedPrefix = nullptr; // only if the writer has routes
+    bool              _routedJson = false;
+    LogBuffer         _buffer;
+    size_t            _timeStart = 0;
+    size_t            _timeEnd = 0;
+    size_t            _messageStart = 0;
+    LogBuffer         _fields; // see kv()
+    LogBuffer         _jsonFields; // the same, as JSON members, if `_routedJson`
+    bool              _usedStream = false;
+
+    template <typename T>
+    void appendField(LogBuffer& fields, const bool json, const std::string_view key, const T& value) {
+      if (json) {
+        fields.append(',');
+        JsonFormatter::appendString(fields, key);
+        fields.append(':');
+      } else {
+        fields.append(' ');
+        fields.append(key);
+        fields.append('=');
+      }
+
+      if constexpr (std::is_same_v<T, bool>) {
+        fields.append(value ? std::string_view("true") : std::string_view("false"));
+      } else if constexpr (ValueFormatter::isInteger<T>) {
+        ValueFormatter::appendInteger(fields, value);
+      } else if constexpr (std::is_floating_point_v<T>) {
+        if (!json || std::isfinite(value)) {
+          ValueFormatter::appendFloatingPoint(fields, value);
+        } else {
+          LogBuffer text; // JSON has no NaN nor infinity
+          ValueFormatter::appendFloatingPoint(text, value);
+          JsonFormatter::appendString(fields, text.view());
+        }
+      } else if constexpr (std::is_same_v<T, char>) {
+        JsonFormatter::appendString(fields, std::string_view(&value, 1));
+      } else if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, char*>) {
+        JsonFormatter::appendString(fields, value != nullptr ? std::string_view(value) : std::string_view("(null)"));
+      } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        JsonFormatter::appendString(fields, std::string_view(value));
+      } else {
+        LogBuffer text;
+        {
+          LogBufferStream::Target target(LogBufferStream::forThisThread(), text, !_usedStream);
+          _usedStream = true;
+          target.stream() << value;
+        }
+        JsonFormatter::appendString(fields, text.view());
+      }
+    }
+
+    void writeRouted(const size_t messageEnd) {
+      const std::string_view text = _buffer.view();
+      const FormattedLine line{
+        text, _level, *_routedPrefix,
+        text.substr(_timeStart, _timeEnd - _timeStart),
+        text.substr(_messageStart, messageEnd - _messageStart),
+        _jsonFields.view()
+      };
+      if (_recordOnly) {
+        _writer->record(line);
+      } else {
+        _writer->write(line);
+      }
+    }
+
+    template <typename T>
+    void insertIntoStream(const T& message) {
+      if (_binary) {
+        LogBuffer text;
+        {
+          LogBufferStream::Target target(LogBufferStream::forThisThread(), text, !_usedStream);
+          _usedStream = true;
+          target.stream() << message;
+        }
+        BinaryLog::appendText(_buffer, text.view());
+        return;
+      }
+
+      if (_json) {
+        LogBuffer text;
+        {
+          LogBufferStream::Target target(LogBufferStream::forThisThread(), text, !_usedStream);
+          _usedStream = true;
+          target.stream() << message;
+        }
+        JsonFormatter::appendEscaped(_buffer, text.view());
+        return;
+      }
+
+      LogBufferStream::Target target(LogBufferStream::forThisThread(), _buffer, !_usedStream);
+      _usedStream = true;
+      target.stream() << message;
+    }
+
+    template <typename T>
+    void appendInteger(const T message) {
+      if (_binary) {
+        BinaryLog::appendInteger(_buffer, message);
+      } else {
+        ValueFormatter::appendInteger(_buffer, message);
+      }
+    }
+
+    template <typename T>
+    void appendFloatingPoint(const T message) {
+      if (_binary) {
+        BinaryLog::appendFloatingPoint(_buffer, message);
+      } else {
+        ValueFormatter::appendFloatingPoint(_buffer, message);
+      }
+    }
 
-    LogsObserver*     _callback;
+    void appendPointer(const void* message) {
+      if (_binary) {
+        BinaryLog::appendPointer(_buffer, message);
+      } else {
+        ValueFormatter::appendPointer(_buffer, message);
+      }
+    }
+
+    void appendBool(const bool message) {
+      if (_binary) {
+        BinaryLog::appendBool(_buffer, message);
+      } else {
+        ValueFormatter::appendBool(_buffer, message);
+      }
+    }
+
+    void appendText(const std::string_view message) {
+      if (_binary) {
+        BinaryLog::appendText(_buffer, message);
+      } else if (_json) {
+        JsonFormatter::appendEscaped(_buffer, message);
+      } else {
+        _buffer.append(message);
+      }
+    }
 
-    std::string       _formattedTime;
-    std::string       _formattedAppName;
-    std::string       _formattedLogLevel;
-    std::string       _formattedLoggerName;
+    // In binary mode, the segments are only referenced, by the format's ID.
+    template <FormatString Format, size_t... I, typename... Args>
+    void appendFormatted(std::index_sequence<I...>, const Args&... args) {
+      if (_binary) {
+        BinaryLog::appendFormatStart(_buffer, _writer->registerFormat<Format>());
+        ((*this << args, BinaryLog::appendNextSegment(_buffer)), ...);
+        return;
+      }
+      appendSegment<Format, 0>();
+      ((*this << args, appendSegment<Format, I + 1>()), ...);
+    }
 
-    std::stringstream _ss;
+    template <FormatString Format, size_t I>
+    void appendSegment() {
+      constexpr std::string_view segment = ParsedFormat<Format>::template segment<I>();
+      if constexpr (!segment.empty()) {
+        if (_json && ParsedFormat<Format>::NEEDS_JSON_ESCAPING) {
+          appendText(segment);
+        } else {
+          _buffer.append(segment);
+        }
+      }
+    }
 
-    std::mutex*       _streamMutex;
-    std::mutex*       _callbackMutex;
+    // Only lines that went through the stream can have changed its formatting state
+    [[nodiscard]] bool formatChanged() const {
+      return _usedStream && LogBufferStream::forThisThread().formatChanged();
+    }
   };
 
 } // namespace ulog
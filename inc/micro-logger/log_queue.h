@@ -0,0 +1,148 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace ulog {
+
+  // Bounded lock-free ring buffer (Dmitry Vyukov's bounded MPMC queue).
+  //
+  // Any number of logging threads can push concurrently; the background writer is the regular
+  // consumer. Popping is also CAS-based, so a producer can evict the oldest entry when needed.
+  // Slots are constructed once and reused, so a `T` that keeps its capacity (e.g. std::string)
+  // stops allocating once the queue has warmed up.
+  template <typename T>
+  class BoundedLogQueue {
+  public:
+    explicit BoundedLogQueue(size_t capacity)
+        : _capacity(roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity)),
+          _mask(_capacity - 1),
+          _cells(new Cell[_capacity]),
+          _enqueuePos(0),
+          _dequeuePos(0) {
+      for (size_t i = 0; i < _capacity; ++i) {
+        _cells[i].sequence.store(i, std::memory_order_relaxed);
+      }
+    }
+
+    BoundedLogQueue(const BoundedLogQueue&) = delete;
+    BoundedLogQueue& operator=(const BoundedLogQueue&) = delete;
+
+    // Calls `fill(T& slot)` on a free slot; returns false (without calling `fill`) if full.
+    template <typename F>
+    bool tryPush(F&& fill) {
+      size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+      for (;;) {
+        Cell& cell = _cells[pos & _mask];
+        const size_t seq = cell.sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0) {
+          if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            fill(cell.value);
+            cell.sequence.store(pos + 1, std::memory_order_release);
+            return true;
+          }
+        } else if (diff < 0) {
+          return false;
+        } else {
+          pos = _enqueuePos.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    // Calls `consume(T& slot)` on the oldest entry; returns false (without calling it) if empty.
+    template <typename F>
+    bool tryPop(F&& consume) {
+      size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+      for (;;) {
+        Cell& cell = _cells[pos & _mask];
+        const size_t seq = cell.sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+        if (diff == 0) {
+          if (_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            consume(cell.value);
+            cell.sequence.store(pos + _mask + 1, std::memory_order_release);
+            return true;
+          }
+        } else if (diff < 0) {
+          return false;
+        } else {
+          pos = _dequeuePos.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    [[nodiscard]] bool empty() const {
+      const size_t pos = _dequeuePos.load(std::memory_order_acquire);
+      const size_t seq = _cells[pos & _mask].sequence.load(std::memory_order_acquire);
+      return static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1) < 0;
+    }
+
+    // Approximate; only meaningful as a hint (e.g. for metrics).
+    [[nodiscard]] size_t size() const {
+      const size_t tail = _dequeuePos.load(std::memory_order_relaxed);
+      const size_t head = _enqueuePos.load(std::memory_order_relaxed);
+      return head > tail ? head - tail : 0;
+    }
+
+    [[nodiscard]] size_t capacity() const {
+      return _capacity;
+    }
+
+  private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    struct alignas(CACHE_LINE_SIZE) Cell {
+      std::atomic<size_t> sequence;
+      T                   value;
+    };
+
+    const size_t            _capacity;
+    const size_t            _mask;
+    std::unique_ptr<Cell[]> _cells;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> _enqueuePos;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> _dequeuePos;
+
+    static size_t roundUpToPowerOfTwo(size_t value) {
+      size_t result = 1;
+      while (result < value) {
+        result <<= 1;
+      }
+      return result;
+    }
+  };
+
+} // namespace ulog
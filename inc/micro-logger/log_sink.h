@@ -0,0 +1,130 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+
+namespace ulog {
+
+  // Destination of the formatted log lines, for outputs that are not a std::ostream (see
+  // MmapFileSink). A LoggerFactory created from a std::ostream wraps it in an OstreamSink.
+  //
+  // Calls are serialized by the LogWriter (under the stream mutex, or on the async writer thread),
+  // unless thread safety was disabled on the LoggerFactory.
+  class LogSink {
+  public:
+    virtual void write(const char* data, size_t size) = 0;
+
+    virtual void flush() {
+      // empty
+    }
+
+    // Stream writing straight to the sink, for Logger::rawOutputStream.
+    virtual std::ostream& rawStream() {
+      if (_rawStream == nullptr) {
+        _rawStream.reset(new RawStream(*this));
+      }
+      return *_rawStream;
+    }
+
+    virtual ~LogSink() = default;
+
+  private:
+    class RawStream : public std::ostream {
+    public:
+      explicit RawStream(LogSink& sink) : std::ostream(&_streambuf), _streambuf(sink) {
+        // empty
+      }
+
+    private:
+      class Streambuf : public std::streambuf {
+      public:
+        explicit Streambuf(LogSink& sink) : _sink(sink) {
+          // empty
+        }
+
+      protected:
+        int_type overflow(const int_type c) override {
+          if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            const char character = traits_type::to_char_type(c);
+            _sink.write(&character, 1);
+          }
+          return traits_type::not_eof(c);
+        }
+
+        std::streamsize xsputn(const char* s, const std::streamsize n) override {
+          _sink.write(s, static_cast<size_t>(n));
+          return n;
+        }
+
+        int sync() override {
+          _sink.flush();
+          return 0;
+        }
+
+      private:
+        LogSink& _sink;
+      };
+
+      Streambuf _streambuf;
+    };
+
+    std::unique_ptr<std::ostream> _rawStream;
+  };
+
+  // Writes to a std::ostream (e.g. std::cout or a std::ofstream).
+  class OstreamSink : public LogSink {
+  public:
+    explicit OstreamSink(std::ostream& stream) : _stream(stream) {
+      // empty
+    }
+
+    void write(const char* data, const size_t size) override {
+      _stream.write(data, static_cast<std::streamsize>(size));
+    }
+
+    void flush() override {
+      _stream.flush();
+    }
+
+    std::ostream& rawStream() override {
+      return _stream;
+    }
+
+  private:
+    std::ostream& _stream;
+  };
+
+} // namespace ulog
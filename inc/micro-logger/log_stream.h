@@ -31,128 +31,130 @@ SOFTWARE.
 
 #pragma once
 
+#include <atomic>
 #include <chrono> // don't remove - needed with GCC -Werror
 #include <string>
-#include <iomanip>
-#include <mutex>
+#include <memory>
 
+#include "line_prefix.h"
+#include "log_level.h"
 #include "log_message_builder.h"
+#include "timestamp_cache.h"
 
 namespace ulog {
 
-  class LogsObserver;
-
   class LogStream {
   public:
-    mutable long lastCalledAtSecondsSinceEpoch;
-    mutable long callsCounter;
-
     LogStream(
-      std::ostream& stream,
-      const bool alwaysFlush,
-      LogsObserver* callback,
-      std::string formattedAppName,
-      std::string formattedLogLevel,
-      std::string formattedLoggerName,
-      std::mutex* streamMutex,
-      std::mutex* callbackMutex
-    ) : lastCalledAtSecondsSinceEpoch(-1),
-        callsCounter(0),
-        _stream(stream),
-        _alwaysFlush(alwaysFlush),
-        _callback(callback),
-        _formattedAppName(std::move(formattedAppName)),
-        _formattedLogLevel(std::move(formattedLogLevel)),
-        _formattedLoggerName(std::move(formattedLoggerName)),
-        _streamMutex(streamMutex),
-        _callbackMutex(callbackMutex) {
+      std::shared_ptr<LogWriter> writer,
+      const LogLevel level,
+      std::shared_ptr<const std::atomic<LogLevel>> minLevel,
+      std::shared_ptr<const LinePrefix> prefix,
+      const TimestampPrecision timestampPrecision = MILLISECONDS
+    ) : _writer(std::move(writer)),
+        _level(level),
+        _minLevel(std::move(minLevel)),
+        _prefix(std::move(prefix)),
+        _timestampPrecision(timestampPrecision),
+        _siteId(registerSite()) {
       // empty
     }
 
+    // False if the line would be discarded because of the minimum level (and isn't kept by a
+    // FlightRecorder either); nothing is formatted then.
+    [[nodiscard]] bool enabled() const {
+      return _level >= ULOG_ACTIVE_LEVEL
+        && (_level >= _minLevel->load(std::memory_order_relaxed) || _writer->records(_level));
+    }
+
     template <typename T>
     LogMessageBuilder operator<<(const T& message) const {
-      const auto now = getCurrentTime();
-      lastCalledAtSecondsSinceEpoch = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
-      ++callsCounter;
-
-      const auto formattedTime = formatCurrentTime(now);
-
-      auto builder = LogMessageBuilder(
-        _stream,
-        _alwaysFlush,
-        _callback,
-        formattedTime, _formattedAppName, _formattedLogLevel, _formattedLoggerName,
-        _streamMutex, _callbackMutex
-      );
+      auto builder = startLine();
       builder << message;
       return builder;
     }
 
-//// Setter
-  void formattedAppName(std::string formattedAppName) {
-      _formattedAppName = std::move(formattedAppName);
-  }
+    // Starts a line from a format string checked at compile time, e.g.
+    // `logger.info.fmt<"user={} took {}us">(id, us)`; see LogMessageBuilder::fmt.
+    template <FormatString Format, typename... Args>
+    LogMessageBuilder fmt(const Args&... args) const {
+      auto builder = startLine();
+      builder.fmt<Format>(args...);
+      return builder;
+    }
 
-  private:
-    std::ostream&     _stream;
-    bool              _alwaysFlush;
+    // Starts a line with a key-value field, e.g. `logger.info.kv("latency_us", x) << "Done"`;
+    // see LogMessageBuilder::kv.
+    template <typename T>
+    LogMessageBuilder kv(const std::string_view key, const T& value) const {
+      auto builder = startLine();
+      builder.kv(key, value);
+      return builder;
+    }
 
-    LogsObserver*     _callback;
+    // Has the writer write `source`'s notice later, as a line of this stream's level.
+    void deferNotice(DeferredNotice* source) const {
+      _writer->deferNotice(source, _level);
+    }
 
-    std::string       _formattedAppName;
-    std::string       _formattedLogLevel;
-    std::string       _formattedLoggerName;
+//// Setter
+  void formattedAppName(const std::string& formattedAppName) {
+      _prefix = _prefix->withAppName(formattedAppName);
+      _siteId = registerSite();
+  }
 
-    std::mutex*       _streamMutex;
-    std::mutex*       _callbackMutex;
+  void minLevel(std::shared_ptr<const std::atomic<LogLevel>> minLevel) {
+      _minLevel = std::move(minLevel);
+  }
 
-    //// Time
+//// Time
     static std::chrono::system_clock::time_point getCurrentTime() {
       return std::chrono::system_clock::now();
     }
 
-    static std::string formatCurrentTime(std::chrono::system_clock::time_point now) {
-      auto now_ms = std::chrono::time_point_cast<std::chrono::milliseconds>(now);
-      auto now_s = std::chrono::time_point_cast<std::chrono::seconds>(now);
-      auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now_ms - now_s);
+    static std::string formatCurrentTime(
+      const std::chrono::system_clock::time_point now,
+      const TimestampPrecision precision = MILLISECONDS
+    ) {
+      return TimestampCache::format(now, precision);
+    }
+
+  private:
+    std::shared_ptr<LogWriter> _writer;
+
+    LogLevel          _level;
+    std::shared_ptr<const std::atomic<LogLevel>> _minLevel;
 
-      std::time_t time = std::chrono::system_clock::to_time_t(now);
+    std::shared_ptr<const LinePrefix> _prefix;
 
-      // Use thread-safe localtime_r if available, otherwise fall back to localtime with protection
-      std::tm local_time_buf;
-      std::tm* local_time;
+    TimestampPrecision _timestampPrecision;
 
-#if defined(_WIN32)
-      // Windows uses localtime_s
-      if (localtime_s(&local_time_buf, &time) == 0) {
-        local_time = &local_time_buf;
-      } else {
-        // Fallback to localtime (not thread-safe but better than crashing)
-        local_time = std::localtime(&time);
+    uint32_t          _siteId; // binary mode only
+
+    LogMessageBuilder startLine() const {
+      if (_level < ULOG_ACTIVE_LEVEL) {
+        return {};
+      }
+      const bool recordOnly = _level < _minLevel->load(std::memory_order_relaxed);
+      if (recordOnly && !_writer->records(_level)) {
+        return {};
       }
-#elif defined(_POSIX_C_SOURCE) || defined(_GNU_SOURCE)
-      // POSIX systems have localtime_r
-      local_time = localtime_r(&time, &local_time_buf);
-#else
-      // Fallback: use a static mutex to protect localtime
-      static std::mutex localtime_mutex;
-      std::lock_guard<std::mutex> lock(localtime_mutex);
-      std::tm* temp = std::localtime(&time);
-      if (temp) {
-        local_time_buf = *temp;
-        local_time = &local_time_buf;
-      } else {
-        local_time = nullptr;
+
+      const auto now = _writer->now();
+
+      if (_writer->binary()) {
+        return {_writer.get(), _level, now, _siteId};
       }
-#endif
+      return {_writer.get(), _level, now, _timestampPrecision, *_prefix, recordOnly};
+    }
 
-      std::stringstream ss;
-      if (local_time) {
-        ss << std::put_time(local_time, "%Y-%m-%d %H:%M:%S") << "." << std::setfill('0') << std::setw(3) << ms.count();
-      } else {
-        ss << "ERROR-TIME." << std::setfill('0') << std::setw(3) << ms.count();
+    uint32_t registerSite() const {
+      if (!_writer->binary()) {
+        return BinaryLog::RAW_TEXT_SITE;
       }
-      return ss.str();
+      return _writer->registerSite(
+        _prefix->formattedAppName(), _prefix->formattedLogLevel(), _prefix->formattedLoggerName(), _timestampPrecision
+      );
     }
   };
 
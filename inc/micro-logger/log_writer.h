@@ -0,0 +1,1066 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "binary_log.h"
+#include "duplicate_coalescer.h"
+#include "flight_recorder.h"
+#include "flush_policy.h"
+#include "format_string.h"
+#include "formatted_line.h"
+#include "log_buffer.h"
+#include "log_clock.h"
+#include "log_level.h"
+#include "log_queue.h"
+#include "log_sink.h"
+#include "logger_metrics.h"
+#include "logs_observer.h"
+#include "observer_registry.h"
+
+namespace ulog {
+
+  // What an asynchronous LogWriter does with a new line when its queue is full.
+  enum QueueFullPolicy {
+    BLOCK,        // wait for free space, up to the configured timeout, then drop the new line
+    DROP_NEWEST,  // drop the new line
+    DROP_OLDEST   // evict the oldest queued line to make room
+  };
+
+  // Something that logs through a LogWriter and may hold a notice to write later, e.g. the count of
+  // calls a rate-limited call site suppressed (see CallSiteLimiter). Sources are expected to live
+  // as long as the program, like the function-local statics the ULOG_ rate limit macros declare.
+  class DeferredNotice {
+  public:
+    // The notice to write now ("" for none), or nullopt to be asked again later; `force` (on
+    // flush and shutdown) asks for whatever is pending.
+    virtual std::optional<std::string> takeNotice(bool force) = 0;
+
+  protected:
+    ~DeferredNotice() = default;
+  };
+
+  // Writes finished log lines to the output sink, the LogsObserver, and the observers registered in
+  // the ObserverRegistry.
+  //
+  // A writer is shared by all the loggers a LoggerFactory created with the same output settings.
+  // In synchronous mode (the default), lines are written on the calling thread, as they always
+  // were. In asynchronous mode, callers only push the line into a bounded lock-free queue and a
+  // dedicated thread drains it to the sink and the observer; the queue is drained and the thread
+  // joined when the writer is destroyed.
+  //
+  // Lines dropped because of the QueueFullPolicy are counted, and a single "N messages dropped"
+  // line (formatted by `formatNotice`) is written once the queue has room again.
+  //
+  // The sink is flushed according to the FlushPolicy; see there.
+  //
+  // With thread buffering (synchronous mode only), each thread appends its lines to its own staging
+  // buffer and writes it to the sink in one piece under the stream mutex once it holds
+  // `threadBufferSize` bytes, on a line at ERROR or that the FlushPolicy flushes at, on `flush()`,
+  // and when the thread exits; the flusher thread writes the buffers out every `threadBufferDelay`.
+  // The lines of a thread keep their order. The LogsObserver is still called for each line.
+  //
+  // With a FlightRecorder, every line is also recorded in its ring, and `record` keeps lines below
+  // the minimum level there only. Before a line at ERROR, and on `dumpFlightRecorder()`, the lines
+  // below the minimum level recorded since the last dump are written, between two notices.
+  //
+  // With routes (other sinks, see LoggerFactory::addSink), the LogStreams format lines as text once,
+  // as FormattedLines, and each route's own writer gets the lines at or above its level, rendered
+  // in its format; this writer's sink gets them in its own format (text, or JSON in JSON mode).
+  //
+  // With duplicate coalescing, a line repeating the previous one (timestamp aside) is only counted,
+  // and a "Last message repeated N times" notice is written once the run ends (see
+  // DuplicateCoalescer), or on `flush()`; in synchronous mode, the flusher thread also writes it
+  // once its window has passed. Not in binary mode.
+  //
+  // The notices of DeferredNotice sources (see `deferNotice`) are written on `flush()`, when the
+  // writer is destroyed, and from the flusher thread when the source has them ready.
+  //
+  // In binary mode, "lines" are BinaryLog records and the LogsObserver receives them decoded. In
+  // JSON mode, the LogStreams writing to it (and `formatNotice`) format lines as JSON objects.
+  class LogWriter {
+  public:
+    static constexpr auto BLOCK_FOREVER = std::chrono::milliseconds::max();
+    static constexpr auto DEFAULT_THREAD_BUFFER_DELAY = std::chrono::milliseconds(50);
+    static constexpr auto NO_COALESCING = std::chrono::milliseconds::zero();
+
+    struct Route {
+      std::shared_ptr<LogWriter>  writer;
+      LogLevel                    minLevel;
+      SinkFormat                  format;
+      std::shared_ptr<std::mutex> mutex; // the writer's stream mutex
+    };
+
+    // The writer's settings; only `sink` is required.
+    struct Options {
+      std::shared_ptr<LogSink>          sink;
+      FlushPolicy                       flushPolicy;
+      LogsObserver*                     callback = nullptr;
+      std::shared_ptr<ObserverRegistry> observers;
+      std::mutex*                       streamMutex = nullptr;   // nullptr when not thread safe
+      std::mutex*                       callbackMutex = nullptr; // nullptr when not thread safe
+      size_t                            asyncQueueCapacity = 0;  // 0 for synchronous mode
+      QueueFullPolicy                   queueFullPolicy = BLOCK;
+      std::chrono::milliseconds         blockTimeout = BLOCK_FOREVER;
+      std::function<std::string(const std::string&)> formatNotice; // nullptr to write notices as is
+      bool                              binary = false;
+      bool                              json = false;
+      std::shared_ptr<LoggerMetrics>    metrics;
+      size_t                            threadBufferSize = 0;    // 0 without thread buffering
+      std::chrono::milliseconds         threadBufferDelay = DEFAULT_THREAD_BUFFER_DELAY;
+      std::shared_ptr<FlightRecorder>   flightRecorder;
+      std::vector<Route>                routes;
+      std::chrono::milliseconds         coalesceWindow = NO_COALESCING;
+      std::shared_ptr<LogClock>         clock;                   // nullptr for std::chrono::system_clock
+    };
+
+    explicit LogWriter(Options options)
+      : _sink(std::move(options.sink)),
+        _callback(options.callback),
+        _observers(std::move(options.observers)),
+        _streamMutex(options.streamMutex),
+        _callbackMutex(options.callbackMutex),
+        _binary(options.binary),
+        _json(options.json && !options.binary),
+        _flushPolicy(options.flushPolicy),
+        _queueFullPolicy(options.queueFullPolicy),
+        _blockTimeout(options.blockTimeout),
+        _formatNotice(std::move(options.formatNotice)),
+        _metrics(std::move(options.metrics)),
+        _threadBufferSize(options.asyncQueueCapacity == 0 && options.streamMutex != nullptr ? options.threadBufferSize : 0),
+        _threadBufferDelay(options.threadBufferDelay),
+        _flightRecorder(options.binary ? nullptr : std::move(options.flightRecorder)),
+        _recordedLevel(_flightRecorder != nullptr ? static_cast<int>(_flightRecorder->level()) : ULOG_LEVEL_OFF),
+        _routes(options.binary ? std::vector<Route>() : std::move(options.routes)),
+        _coalescer(options.binary || options.coalesceWindow <= NO_COALESCING
+                   ? nullptr : new DuplicateCoalescer(options.coalesceWindow)),
+        _clock(std::move(options.clock)) {
+      for (const Route& route : _routes) {
+        _routedJson = _routedJson || _json || route.format == JSON_LINES;
+      }
+      if (_binary) {
+        LogBuffer header;
+        BinaryLog::appendHeader(header);
+        writeToStream(header.view());
+        _decoder.reset(new BinaryLogDecoder());
+      }
+      if (options.asyncQueueCapacity > 0) {
+        _queue.reset(new BoundedLogQueue<QueuedLine>(options.asyncQueueCapacity));
+        _thread = std::thread(&LogWriter::run, this);
+      } else if ((_flushPolicy.every() != FlushPolicy::NO_INTERVAL || _threadBufferSize > 0 || _coalescer != nullptr)
+                 && _streamMutex != nullptr) {
+        _thread = std::thread(&LogWriter::runFlusher, this);
+      }
+    }
+
+    LogWriter(const LogWriter&) = delete;
+    LogWriter& operator=(const LogWriter&) = delete;
+
+    ~LogWriter() {
+      endRepeats(true);
+      writeDeferredNotices(true);
+      stop();
+      closeStagingBuffers();
+    }
+
+    void write(const std::string_view logMessage, const LogLevel level) {
+      if (_flightRecorder != nullptr && level >= _recordedLevel) {
+        if (level >= ERROR) {
+          writeFlightRecorder("before this error");
+        }
+        _flightRecorder->record(logMessage, level, true);
+      }
+      submit(logMessage, level);
+    }
+
+    // A line of which `time` is the timestamp: with duplicate coalescing, only counted if it
+    // repeats the previous line.
+    void write(const std::string_view logMessage, const LogLevel level, const std::string_view time) {
+      if (_coalescer == nullptr || !coalesce(logMessage, level, time)) {
+        write(logMessage, level);
+      }
+    }
+
+    // A line formatted for the routes: written to this writer's sink, and to each route's.
+    void write(const FormattedLine& line) {
+      if (_coalescer != nullptr && coalesce(line.text, line.level, line.time)) {
+        return;
+      }
+      {
+        LogBuffer rendering;
+        write(line.render(_json ? JSON_LINES : TEXT, rendering), line.level);
+      }
+      for (const Route& route : _routes) {
+        if (line.level >= route.minLevel) {
+          LogBuffer rendering;
+          route.writer->write(line.render(route.format, rendering), line.level);
+        }
+      }
+    }
+
+    void record(const FormattedLine& line) {
+      LogBuffer rendering;
+      record(line.render(_json ? JSON_LINES : TEXT, rendering), line.level);
+    }
+
+    // Whether the FlightRecorder keeps the lines of `level` that are below the minimum level.
+    [[nodiscard]] bool records(const LogLevel level) const {
+      return level >= _recordedLevel;
+    }
+
+    // A line below the minimum level: only kept by the FlightRecorder.
+    void record(const std::string_view logMessage, const LogLevel level) {
+      _flightRecorder->record(logMessage, level, false);
+    }
+
+    // Writes the lines below the minimum level that the FlightRecorder kept since its last dump.
+    void dumpFlightRecorder() {
+      if (_flightRecorder != nullptr) {
+        writeFlightRecorder("most recent");
+      }
+    }
+
+    // Writes a line of the LoggerFactory's logger (formatted by `formatNotice`), counted at `level`.
+    void notice(const std::string& text, const LogLevel level) {
+      const std::string line = _formatNotice ? _formatNotice(text) : text + "\n";
+      if (!_binary) {
+        submit(line, level);
+        return;
+      }
+      LogBuffer record;
+      appendRawText(record, line);
+      submit(record.view(), level);
+    }
+
+    // `source` holds a notice for the lines of `level`: it is written later, unless `source` gives
+    // it nothing by then. Called at most once per pending notice by each source.
+    void deferNotice(DeferredNotice* source, const LogLevel level) {
+      std::lock_guard<std::mutex> lock(_deferredMutex);
+      _deferred.push_back({source, level});
+    }
+
+    // Binary mode: writes the static part of a LogStream's lines once and returns its site ID.
+    // Unlike log lines, site records are never dropped by the QueueFullPolicy.
+    uint32_t registerSite(
+      const std::string_view formattedAppName,
+      const std::string_view formattedLogLevel,
+      const std::string_view formattedLoggerName,
+      const TimestampPrecision timestampPrecision
+    ) {
+      const uint32_t siteId = _nextSiteId.fetch_add(1, std::memory_order_relaxed);
+      LogBuffer record;
+      BinaryLog::appendSite(record, siteId, formattedAppName, formattedLogLevel, formattedLoggerName, timestampPrecision);
+      writeDefinition(record.view());
+      return siteId;
+    }
+
+    // Binary mode: the ID of the format string of `fmt<Format>` lines, whose literal segments are
+    // written once per writer, as a format record, before the first line using it. After that,
+    // checking a format costs an atomic load, as long as the process logs to a single writer.
+    template <FormatString Format>
+    uint32_t registerFormat() {
+      static const uint32_t formatId = _nextFormatId.fetch_add(1, std::memory_order_relaxed);
+      static std::atomic<uint64_t> registeredWith{0}; // the last writer that wrote the format record
+      if (registeredWith.load(std::memory_order_acquire) != _writerId) {
+        registerFormat(formatId, ParsedFormat<Format>::segments());
+        registeredWith.store(_writerId, std::memory_order_release);
+      }
+      return formatId;
+    }
+
+    // Writes the format record of `formatId` unless already written. The record is written (or
+    // queued) before the mutex is released, so before any line that finds it registered.
+    void registerFormat(const uint32_t formatId, const std::span<const std::string_view> segments) {
+      std::lock_guard<std::mutex> lock(_formatsMutex);
+      if (!_formats.insert(formatId).second) {
+        return;
+      }
+      LogBuffer record;
+      BinaryLog::appendFormat(record, formatId, segments);
+      writeDefinition(record.view());
+    }
+
+    // Blocks until every line logged before the call has been written and the sink flushed.
+    void flush() {
+      endRepeats(true);
+      writeDeferredNotices(true);
+      for (const Route& route : _routes) {
+        route.writer->flush();
+      }
+      if (_queue == nullptr) {
+        publishStagingBuffers();
+        flushStream();
+        return;
+      }
+
+      const uint64_t target = _pushed.load(std::memory_order_acquire);
+      requestFlush(target);
+
+      std::unique_lock<std::mutex> lock(_wakeMutex);
+      _wakeCondition.notify_one();
+      _drainedCondition.wait(lock, [&] { return _flushed.load(std::memory_order_acquire) >= target; });
+    }
+
+    // Number of lines dropped so far because the queue was full.
+    [[nodiscard]] uint64_t droppedCount() const {
+      return _dropped.load(std::memory_order_relaxed);
+    }
+
+    // Async mode: approximate number of lines waiting in the queue.
+    [[nodiscard]] size_t queueDepth() const {
+      return _queue != nullptr ? _queue->size() : 0;
+    }
+
+    [[nodiscard]] size_t queueCapacity() const {
+      return _queue != nullptr ? _queue->capacity() : 0;
+    }
+
+    [[nodiscard]] bool async() const {
+      return _queue != nullptr;
+    }
+
+    [[nodiscard]] bool binary() const {
+      return _binary;
+    }
+
+    // Whether the LogStreams format lines as JSON (JSON mode, without routes).
+    [[nodiscard]] bool json() const {
+      return _json && _routes.empty();
+    }
+
+    // Whether the LogStreams format lines as FormattedLines, for the routes.
+    [[nodiscard]] bool routed() const {
+      return !_routes.empty();
+    }
+
+    // Whether FormattedLines need their fields formatted as JSON too.
+    [[nodiscard]] bool routedJson() const {
+      return _routedJson;
+    }
+
+    [[nodiscard]] std::ostream& stream() const {
+      return _sink->rawStream();
+    }
+
+    // The time for a new line, from the LogClock if any.
+    [[nodiscard]] std::chrono::system_clock::time_point now() const {
+      return _clock != nullptr ? _clock->now() : std::chrono::system_clock::now();
+    }
+
+  private:
+    std::shared_ptr<LogSink> _sink;
+
+    LogsObserver*     _callback;
+    std::shared_ptr<ObserverRegistry> _observers;
+
+    std::mutex*       _streamMutex;
+    std::mutex*       _callbackMutex;
+
+    //// Binary mode
+    bool              _binary;
+    std::unique_ptr<BinaryLogDecoder> _decoder; // for the observers, fed every site record
+    std::mutex        _decoderMutex;
+
+    static inline std::atomic<uint32_t> _nextSiteId{BinaryLog::RAW_TEXT_SITE + 1};
+    static inline std::atomic<uint32_t> _nextFormatId{0};
+    static inline std::atomic<uint64_t> _nextWriterId{1};
+
+    const uint64_t    _writerId = _nextWriterId.fetch_add(1, std::memory_order_relaxed); // never 0
+    std::mutex        _formatsMutex;
+    std::unordered_set<uint32_t> _formats; // IDs of the format records written, under _formatsMutex
+
+    bool              _json;
+
+    //// Flushing (under the stream mutex in synchronous mode, on the writer thread in async mode)
+    FlushPolicy       _flushPolicy;
+    uint64_t          _writtenLines = 0;
+    uint64_t          _flushedLines = 0;
+    std::chrono::steady_clock::time_point _lastFlush = std::chrono::steady_clock::now();
+    bool              _stoppingFlusher = false; // under _wakeMutex
+
+    //// Async mode
+    static constexpr auto IDLE_WAIT = std::chrono::milliseconds(100);
+    static constexpr size_t MAX_BATCH_SIZE = 256;
+    static constexpr int BLOCK_SPIN_COUNT = 64;
+    static constexpr auto BLOCK_SLEEP = std::chrono::microseconds(50);
+
+    struct QueuedLine {
+      std::string text;
+      LogLevel    level = DEBUG;
+
+      void assign(const std::string_view logMessage, const LogLevel logLevel) {
+        text.assign(logMessage.data(), logMessage.size());
+        level = logLevel;
+      }
+    };
+
+    std::unique_ptr<BoundedLogQueue<QueuedLine>> _queue;
+    std::thread                                   _thread;
+
+    QueueFullPolicy         _queueFullPolicy;
+    std::chrono::milliseconds _blockTimeout;
+    std::function<std::string(const std::string&)> _formatNotice;
+
+    std::atomic<bool>       _stopping{false};
+    std::atomic<bool>       _consumerSleeping{false};
+    std::atomic<uint64_t>   _pushed{0};
+    std::atomic<uint64_t>   _consumed{0}; // written, or evicted by DROP_OLDEST
+    std::atomic<uint64_t>   _dropped{0};
+    uint64_t                _reportedDropped = 0;
+    std::atomic<uint64_t>   _flushTarget{0};
+    std::atomic<uint64_t>   _flushed{0};
+
+    std::mutex              _wakeMutex;
+    std::condition_variable _wakeCondition;
+    std::condition_variable _drainedCondition;
+
+    // Consumer-side scratch buffers, reused between batches
+    std::string             _batch;
+    QueuedLine              _logMessage;
+    std::vector<size_t>     _lineEnds;
+    std::vector<LogLevel>   _lineLevels;
+
+    std::shared_ptr<LoggerMetrics> _metrics; // nullptr unless collecting metrics
+
+    size_t                    _threadBufferSize; // 0 without thread buffering
+    std::chrono::milliseconds _threadBufferDelay;
+
+    std::shared_ptr<FlightRecorder> _flightRecorder; // nullptr without a flight recorder, and in binary mode
+    int                       _recordedLevel;     // ULOG_LEVEL_OFF without a flight recorder
+
+    std::vector<Route>        _routes;
+    bool                      _routedJson = false;
+
+    std::unique_ptr<DuplicateCoalescer> _coalescer; // nullptr without duplicate coalescing, and in binary mode
+
+    std::shared_ptr<LogClock> _clock; // nullptr for std::chrono::system_clock
+
+    struct Deferred {
+      DeferredNotice* source;
+      LogLevel        level;
+    };
+
+    std::mutex                _deferredMutex;
+    std::vector<Deferred>     _deferred; // under _deferredMutex
+
+    // Takes the stream mutex, timing the wait when collecting metrics.
+    [[nodiscard]] std::unique_lock<std::mutex> lockStream() {
+      return lockTimed(*_streamMutex, LoggerMetrics::STREAM_LOCK_WAIT);
+    }
+
+    [[nodiscard]] std::unique_lock<std::mutex> lockTimed(std::mutex& mutex, const LoggerMetrics::Timer timer) {
+      if (_metrics == nullptr) {
+        return std::unique_lock<std::mutex>(mutex);
+      }
+      const auto start = LoggerMetrics::now();
+      std::unique_lock<std::mutex> lock(mutex);
+      _metrics->record(timer, start);
+      return lock;
+    }
+
+    void writeToSink(const std::string_view data) {
+      if (_metrics == nullptr) {
+        _sink->write(data.data(), data.size());
+        return;
+      }
+      const auto start = LoggerMetrics::now();
+      _sink->write(data.data(), data.size());
+      _metrics->record(LoggerMetrics::SINK_WRITE, start);
+    }
+
+    void flushSink() {
+      if (_metrics == nullptr) {
+        _sink->flush();
+        return;
+      }
+      const auto start = LoggerMetrics::now();
+      _sink->flush();
+      _metrics->record(LoggerMetrics::SINK_FLUSH, start);
+    }
+
+    void writeToStream(const std::string_view data) {
+      if (_streamMutex != nullptr) {
+        const auto lock = lockStream();
+        writeToSink(data);
+      } else {
+        writeToSink(data);
+      }
+    }
+
+    // Writes (or queues) a line, and notifies the observers.
+    void submit(const std::string_view logMessage, const LogLevel level) {
+      if (_metrics != nullptr) {
+        _metrics->countMessage(level, logMessage.size());
+      }
+      if (_queue == nullptr) {
+        if (_threadBufferSize > 0) {
+          stage(logMessage, level);
+        } else {
+          writeLine(logMessage, level);
+        }
+        notifyObservers(logMessage, level);
+        return;
+      }
+
+      if (!push(logMessage, level)) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      const uint64_t pushed = _pushed.fetch_add(1, std::memory_order_seq_cst) + 1;
+      if (_flushPolicy.flushesAt(level)) {
+        requestFlush(pushed);
+      }
+      if (_consumerSleeping.load(std::memory_order_seq_cst)) {
+        wakeConsumer();
+      }
+    }
+
+    // Binary mode: a site or format record. Unlike log lines, never dropped by the QueueFullPolicy.
+    void writeDefinition(const std::string_view record) {
+      if (_queue == nullptr) {
+        writeToStream(record);
+        notifyObservers(record, DEBUG);
+        return;
+      }
+
+      const auto fill = [&](QueuedLine& slot) { slot.assign(record, DEBUG); };
+      while (!_queue->tryPush(fill)) {
+        wakeConsumer();
+        std::this_thread::yield();
+      }
+      _pushed.fetch_add(1, std::memory_order_seq_cst);
+      if (_consumerSleeping.load(std::memory_order_seq_cst)) {
+        wakeConsumer();
+      }
+    }
+
+    void writeFlightRecorder(const std::string& when) {
+      const auto lines = _flightRecorder->take(true);
+      if (lines.empty()) {
+        return;
+      }
+      notice("Flight recorder: " + std::to_string(lines.size()) + " lines below the minimum level, " + when, WARNING);
+      for (const auto& line : lines) {
+        submit(line.text, line.level);
+      }
+      notice("Flight recorder: end", WARNING);
+    }
+
+    // Whether the line repeats the previous one; writes the notice of the run it ends, if any.
+    bool coalesce(const std::string_view logMessage, const LogLevel level, const std::string_view time) {
+      DuplicateCoalescer::Run ended;
+      const bool repeated = _coalescer->add(logMessage, time, level, ended);
+      if (ended.repeats > 0) {
+        writeRepeats(ended);
+      }
+      return repeated;
+    }
+
+    // Writes the notice of the current run of repeated lines once its window has passed, or now
+    // with `force`.
+    void endRepeats(const bool force) {
+      DuplicateCoalescer::Run ended;
+      if (_coalescer != nullptr && _coalescer->expire(force, ended)) {
+        writeRepeats(ended);
+      }
+    }
+
+    void writeRepeats(const DuplicateCoalescer::Run& run) {
+      const std::string text = run.repeats == 1
+        ? "Last message repeated once (at " + run.firstTime + ")"
+        : "Last message repeated " + std::to_string(run.repeats) + " times (from " + run.firstTime + " to " + run.lastTime + ")";
+      routedNotice(text, run.level);
+    }
+
+    // Writes the notices of the deferred sources that have them ready, or all of them with `force`.
+    void writeDeferredNotices(const bool force) {
+      std::vector<Deferred> deferred;
+      {
+        std::lock_guard<std::mutex> lock(_deferredMutex);
+        if (_deferred.empty()) {
+          return;
+        }
+        deferred.swap(_deferred);
+      }
+      std::vector<Deferred> notReady;
+      for (const Deferred& entry : deferred) {
+        const auto text = entry.source->takeNotice(force);
+        if (!text.has_value()) {
+          notReady.push_back(entry);
+        } else if (!text->empty()) {
+          routedNotice(*text, entry.level);
+        }
+      }
+      if (!notReady.empty()) {
+        std::lock_guard<std::mutex> lock(_deferredMutex);
+        _deferred.insert(_deferred.end(), notReady.begin(), notReady.end());
+      }
+    }
+
+    // A notice for this writer's sink, and for the routes taking lines of `level`.
+    void routedNotice(const std::string& text, const LogLevel level) {
+      notice(text, level);
+      for (const Route& route : _routes) {
+        if (level >= route.minLevel) {
+          route.writer->notice(text, level);
+        }
+      }
+    }
+
+    // Synchronous mode. The flush, if due, takes the lock again: lines written by other threads
+    // in between are covered by the same flush, and their own flush is skipped.
+    void writeLine(const std::string_view logMessage, const LogLevel level, const uint64_t lineCount = 1) {
+      if (_streamMutex == nullptr) {
+        writeToSink(logMessage);
+        _writtenLines += lineCount;
+        if (flushDue(level)) {
+          flushLines(_writtenLines);
+        }
+        return;
+      }
+
+      uint64_t line;
+      {
+        const auto lock = lockStream();
+        writeToSink(logMessage);
+        line = _writtenLines += lineCount;
+        if (!flushDue(level)) {
+          return;
+        }
+      }
+      const auto lock = lockStream();
+      flushLines(line);
+    }
+
+    [[nodiscard]] bool flushDue(const LogLevel level) const {
+      if (_flushPolicy.flushesAt(level)) {
+        return true;
+      }
+      if (_flushPolicy.everyLines() != FlushPolicy::NO_LINE_LIMIT
+          && _writtenLines - _flushedLines >= _flushPolicy.everyLines()) {
+        return true;
+      }
+      // Without a flusher thread (no stream mutex), the interval is only checked on write
+      return _flushPolicy.every() != FlushPolicy::NO_INTERVAL && _streamMutex == nullptr
+          && std::chrono::steady_clock::now() - _lastFlush >= _flushPolicy.every();
+    }
+
+    // Flushes, unless `line` was already covered by another flush.
+    void flushLines(const uint64_t line) {
+      if (_flushedLines >= line) {
+        return;
+      }
+      flushSink();
+      _flushedLines = _writtenLines;
+      _lastFlush = std::chrono::steady_clock::now();
+    }
+
+    // Synchronous mode with a flush interval, thread buffering and/or duplicate coalescing
+    void runFlusher() {
+      auto interval = std::chrono::milliseconds::max();
+      if (_flushPolicy.every() != FlushPolicy::NO_INTERVAL) {
+        interval = _flushPolicy.every();
+      }
+      if (_threadBufferSize > 0) {
+        interval = std::min(interval, _threadBufferDelay);
+      }
+      if (_coalescer != nullptr) {
+        interval = std::min(interval, _coalescer->window());
+      }
+      std::unique_lock<std::mutex> wakeLock(_wakeMutex);
+      while (!_stoppingFlusher) {
+        _wakeCondition.wait_for(wakeLock, interval);
+        endRepeats(false);
+        writeDeferredNotices(false);
+        publishStagingBuffers();
+        if (_flushPolicy.every() != FlushPolicy::NO_INTERVAL) {
+          const auto lock = lockStream();
+          flushLines(_writtenLines);
+        }
+      }
+    }
+
+    //// Thread buffering
+    struct StagingBuffer {
+      std::mutex              mutex;
+      std::atomic<LogWriter*> writer; // nullptr once the writer is destroyed
+      std::string             lines;  // under `mutex`
+      uint64_t                lineCount = 0;
+      LogLevel                maxLevel = DEBUG;
+      bool                    orphaned = false; // the thread exited
+
+      explicit StagingBuffer(LogWriter* owner) : writer(owner) {
+        // empty
+      }
+    };
+
+    // A thread's staging buffers, one per writer it logged to; written out when the thread exits.
+    class ThreadStagingBuffers {
+    public:
+      ~ThreadStagingBuffers() {
+        for (const auto& buffer : buffers) {
+          std::lock_guard<std::mutex> lock(buffer->mutex);
+          if (LogWriter* writer = buffer->writer.load(std::memory_order_relaxed)) {
+            writer->publish(*buffer);
+          }
+          buffer->orphaned = true;
+        }
+      }
+
+      std::vector<std::shared_ptr<StagingBuffer>> buffers;
+    };
+
+    std::mutex                                  _stagingBuffersMutex;
+    std::vector<std::shared_ptr<StagingBuffer>> _stagingBuffers; // under _stagingBuffersMutex
+
+    StagingBuffer& threadStagingBuffer() {
+      thread_local ThreadStagingBuffers threadBuffers;
+      auto& buffers = threadBuffers.buffers;
+      for (const auto& buffer : buffers) {
+        if (buffer->writer.load(std::memory_order_relaxed) == this) {
+          return *buffer;
+        }
+      }
+
+      std::erase_if(buffers, [](const std::shared_ptr<StagingBuffer>& buffer) {
+        return buffer->writer.load(std::memory_order_relaxed) == nullptr;
+      });
+      buffers.push_back(std::make_shared<StagingBuffer>(this));
+      std::lock_guard<std::mutex> lock(_stagingBuffersMutex);
+      _stagingBuffers.push_back(buffers.back());
+      return *buffers.back();
+    }
+
+    void stage(const std::string_view logMessage, const LogLevel level) {
+      StagingBuffer& buffer = threadStagingBuffer();
+      std::lock_guard<std::mutex> lock(buffer.mutex);
+      buffer.lines.append(logMessage);
+      ++buffer.lineCount;
+      buffer.maxLevel = std::max(buffer.maxLevel, level);
+      if (buffer.lines.size() >= _threadBufferSize || level >= ERROR || _flushPolicy.flushesAt(level)) {
+        publish(buffer);
+      }
+    }
+
+    // Writes out a staging buffer, under its mutex.
+    void publish(StagingBuffer& buffer) {
+      if (buffer.lineCount == 0) {
+        return;
+      }
+      writeLine(buffer.lines, buffer.maxLevel, buffer.lineCount);
+      buffer.lines.clear(); // keeps its capacity
+      buffer.lineCount = 0;
+      buffer.maxLevel = DEBUG;
+    }
+
+    // Writes out every thread's staging buffer, and forgets those of the threads that exited.
+    void publishStagingBuffers() {
+      std::lock_guard<std::mutex> lock(_stagingBuffersMutex);
+      std::erase_if(_stagingBuffers, [&](const std::shared_ptr<StagingBuffer>& buffer) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        publish(*buffer);
+        return buffer->orphaned;
+      });
+    }
+
+    void closeStagingBuffers() {
+      std::lock_guard<std::mutex> lock(_stagingBuffersMutex);
+      for (const auto& buffer : _stagingBuffers) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        publish(*buffer);
+        buffer->writer.store(nullptr, std::memory_order_relaxed);
+      }
+      _stagingBuffers.clear();
+    }
+
+    // Passes a written line (in binary mode, record) to the LogsObserver and the ObserverRegistry.
+    void notifyObservers(const std::string_view logMessage, const LogLevel level) {
+      const bool observed = _observers != nullptr && !_observers->empty();
+      if (_binary) {
+        notifyDecoded(logMessage, level, observed);
+        return;
+      }
+      if (_callback != nullptr) {
+        notifyCallback(std::string(logMessage));
+      }
+      if (observed) {
+        _observers->publish(logMessage, level);
+      }
+    }
+
+    // Site and format records are decoded even without observers, for the lines of observers added later.
+    void notifyDecoded(const std::string_view record, const LogLevel level, const bool observed) {
+      if (_callback == nullptr && !observed
+          && (record.empty() || (record[0] != BinaryLog::SITE && record[0] != BinaryLog::FORMAT))) {
+        return;
+      }
+      const auto onLine = [&](const std::string_view line) {
+        if (_callback != nullptr) {
+          notifyCallback(std::string(line));
+        }
+        if (observed) {
+          _observers->publish(line, level);
+        }
+      };
+      if (_streamMutex != nullptr) {
+        std::lock_guard<std::mutex> lock(_decoderMutex);
+        _decoder->decode(record, onLine);
+      } else {
+        _decoder->decode(record, onLine);
+      }
+    }
+
+    void notifyCallback(const std::string& line) {
+      if (_callbackMutex != nullptr) {
+        const auto lock = lockTimed(*_callbackMutex, LoggerMetrics::CALLBACK_LOCK_WAIT);
+        _callback->onOutputLogMessage(line);
+      } else {
+        _callback->onOutputLogMessage(line);
+      }
+    }
+
+    void flushStream() {
+      if (_streamMutex != nullptr) {
+        const auto lock = lockStream();
+        flushSink();
+      } else {
+        flushSink();
+      }
+    }
+
+    bool push(const std::string_view logMessage, const LogLevel level) {
+      // Slots keep their capacity, so this stops allocating once the queue has warmed up
+      const auto fill = [&](QueuedLine& slot) { slot.assign(logMessage, level); };
+      if (_queue->tryPush(fill)) {
+        return true;
+      }
+
+      switch (_queueFullPolicy) {
+        case DROP_NEWEST:
+          return false;
+
+        case DROP_OLDEST:
+          do {
+            if (_queue->tryPop([](QueuedLine&) {})) {
+              _dropped.fetch_add(1, std::memory_order_relaxed);
+              _consumed.fetch_add(1, std::memory_order_release);
+            }
+          } while (!_queue->tryPush(fill));
+          return true;
+
+        case BLOCK:
+          break;
+      }
+
+      wakeConsumer();
+      const bool forever = _blockTimeout == BLOCK_FOREVER;
+      const auto deadline = forever
+        ? std::chrono::steady_clock::time_point::max()
+        : std::chrono::steady_clock::now() + _blockTimeout;
+      for (int attempt = 0; !_queue->tryPush(fill); ++attempt) {
+        if (attempt < BLOCK_SPIN_COUNT) {
+          std::this_thread::yield();
+          continue;
+        }
+        if (!forever && std::chrono::steady_clock::now() >= deadline) {
+          return false;
+        }
+        wakeConsumer();
+        std::this_thread::sleep_for(BLOCK_SLEEP);
+      }
+      return true;
+    }
+
+    void wakeConsumer() {
+      std::lock_guard<std::mutex> lock(_wakeMutex);
+      _wakeCondition.notify_one();
+    }
+
+    // Asks the writer thread to flush once the first `target` pushed lines are written.
+    void requestFlush(const uint64_t target) {
+      uint64_t requested = _flushTarget.load(std::memory_order_relaxed);
+      while (requested < target
+             && !_flushTarget.compare_exchange_weak(requested, target, std::memory_order_seq_cst)) {
+        // retry
+      }
+    }
+
+    [[nodiscard]] bool flushPending() const {
+      return _flushTarget.load(std::memory_order_seq_cst) > _flushed.load(std::memory_order_relaxed);
+    }
+
+    // Writer thread: lines written since the last flush call for one, per the FlushPolicy.
+    [[nodiscard]] bool flushDueByPolicy() const {
+      const uint64_t unflushed = _writtenLines - _flushedLines;
+      if (unflushed == 0) {
+        return false;
+      }
+      return (_flushPolicy.everyLines() != FlushPolicy::NO_LINE_LIMIT && unflushed >= _flushPolicy.everyLines())
+          || (_flushPolicy.every() != FlushPolicy::NO_INTERVAL
+              && std::chrono::steady_clock::now() - _lastFlush >= _flushPolicy.every());
+    }
+
+    // Writer thread: how long to sleep when idle, to honor the flush interval.
+    [[nodiscard]] std::chrono::steady_clock::duration idleWait() const {
+      if (_flushPolicy.every() == FlushPolicy::NO_INTERVAL || _writtenLines == _flushedLines) {
+        return IDLE_WAIT;
+      }
+      const auto untilFlush = _lastFlush + _flushPolicy.every() - std::chrono::steady_clock::now();
+      return std::min<std::chrono::steady_clock::duration>(IDLE_WAIT, untilFlush);
+    }
+
+    void flushConsumed() {
+      const uint64_t consumed = _consumed.load(std::memory_order_acquire);
+      flushStream();
+      _flushedLines = _writtenLines;
+      _lastFlush = std::chrono::steady_clock::now();
+      std::lock_guard<std::mutex> lock(_wakeMutex);
+      _flushed.store(consumed, std::memory_order_release);
+      _drainedCondition.notify_all();
+    }
+
+    void run() {
+      for (;;) {
+        const size_t count = drainBatch();
+
+        if (flushPending() || flushDueByPolicy()) {
+          flushConsumed();
+        }
+        if (count > 0) {
+          continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_wakeMutex);
+        if (_stopping.load(std::memory_order_acquire) && _queue->empty()) {
+          break;
+        }
+
+        // Either the producer sees the flag, or we see its `_pushed` increment
+        _consumerSleeping.store(true, std::memory_order_seq_cst);
+        const bool idle = _pushed.load(std::memory_order_seq_cst) == _consumed.load(std::memory_order_acquire);
+        if (idle && !flushPending() && !_stopping.load(std::memory_order_relaxed)) {
+          _wakeCondition.wait_for(lock, idleWait());
+        }
+        _consumerSleeping.store(false, std::memory_order_relaxed);
+      }
+
+      flushConsumed();
+    }
+
+    // Writes up to MAX_BATCH_SIZE queued lines to the stream under a single lock acquisition.
+    size_t drainBatch() {
+      size_t count = 0;
+      _batch.clear();
+      _lineEnds.clear();
+      _lineLevels.clear();
+      while (count < MAX_BATCH_SIZE
+             && _queue->tryPop([&](QueuedLine& slot) { std::swap(_logMessage, slot); })) {
+        appendToBatch(_logMessage.text, _logMessage.level);
+        ++count;
+      }
+
+      const uint64_t dropped = _dropped.load(std::memory_order_relaxed);
+      if (dropped > _reportedDropped) {
+        const auto notice = std::to_string(dropped - _reportedDropped) + " messages dropped (log queue full)";
+        appendNoticeToBatch(_formatNotice ? _formatNotice(notice) : notice + "\n");
+        _reportedDropped = dropped;
+      }
+      if (_batch.empty()) {
+        return 0;
+      }
+
+      writeToStream(_batch);
+      _writtenLines += count;
+
+      size_t lineStart = 0;
+      for (size_t line = 0; line < _lineEnds.size(); ++line) {
+        notifyObservers(std::string_view(_batch).substr(lineStart, _lineEnds[line] - lineStart), _lineLevels[line]);
+        lineStart = _lineEnds[line];
+      }
+
+      _consumed.fetch_add(count, std::memory_order_release);
+      return count;
+    }
+
+    void appendNoticeToBatch(const std::string& line) {
+      if (!_binary) {
+        appendToBatch(line, WARNING);
+        return;
+      }
+      LogBuffer record;
+      appendRawText(record, line);
+      appendToBatch(record.view(), WARNING);
+    }
+
+    // Binary mode: a line of text as a record of its own.
+    static void appendRawText(LogBuffer& record, const std::string_view line) {
+      BinaryLog::beginMessage(record, BinaryLog::RAW_TEXT_SITE, 0);
+      BinaryLog::appendText(record, line);
+      BinaryLog::endMessage(record, 0);
+    }
+
+    void appendToBatch(const std::string_view logMessage, const LogLevel level) {
+      _batch += logMessage;
+      _lineEnds.push_back(_batch.size());
+      _lineLevels.push_back(level);
+    }
+
+    void stop() {
+      if (!_thread.joinable()) {
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(_wakeMutex);
+        _stopping.store(true, std::memory_order_release);
+        _stoppingFlusher = true;
+        _wakeCondition.notify_one();
+      }
+      _thread.join();
+    }
+  };
+
+} // namespace ulog
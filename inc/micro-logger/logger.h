@@ -31,15 +31,14 @@ SOFTWARE.
 
 #pragma once
 
+#include <atomic>
 #include <string>
-#include <mutex>
+#include <memory>
 
 #include "log_stream.h"
 
 namespace ulog {
 
-  class LogsObserver;
-
   class Logger {
    public:
     std::ostream& rawOutputStream;
@@ -52,6 +51,7 @@ namespace ulog {
     friend class LoggerFactory;
 
 //// Setter
+    // Text mode only; in JSON mode, lines keep the factory's app name.
     void formattedAppName(const std::string& formattedAppName) {
       debug.formattedAppName(formattedAppName);
       info.formattedAppName(formattedAppName);
@@ -59,21 +59,53 @@ namespace ulog {
       error.formattedAppName(formattedAppName);
     }
 
+    // Overrides the factory's minimum level for this logger only.
+    void minLevel(const LogLevel minLevel) {
+      useMinLevel(std::make_shared<std::atomic<LogLevel>>(minLevel));
+    }
+
+    // Follows the factory's minimum level again.
+    void resetMinLevel() {
+      useMinLevel(_factoryMinLevel);
+    }
+
    protected:
     Logger(
-      std::ostream& stream,
-      const bool alwaysFlush,
-      LogsObserver* callback,
-      const std::string& formattedAppName, const std::string& formattedLoggerName,
-      const std::string& debugTag, const std::string& infoTag, const std::string& warningTag, const std::string& errorTag,
-      std::mutex* streamMutex, std::mutex* callbackMutex
-    ) : rawOutputStream(stream),
-        debug(stream, alwaysFlush, callback, formattedAppName, debugTag, formattedLoggerName, streamMutex, callbackMutex),
-        info(stream, alwaysFlush, callback, formattedAppName, infoTag, formattedLoggerName, streamMutex, callbackMutex),
-        warning(stream, alwaysFlush, callback, formattedAppName, warningTag, formattedLoggerName, streamMutex, callbackMutex),
-        error(stream, alwaysFlush, callback, formattedAppName, errorTag, formattedLoggerName, streamMutex, callbackMutex) {
+      const std::shared_ptr<LogWriter>& writer,
+      const std::shared_ptr<const std::atomic<LogLevel>>& minLevel,
+      const std::shared_ptr<const LinePrefix>& debugPrefix,
+      const std::shared_ptr<const LinePrefix>& infoPrefix,
+      const std::shared_ptr<const LinePrefix>& warningPrefix,
+      const std::shared_ptr<const LinePrefix>& errorPrefix,
+      const TimestampPrecision timestampPrecision
+    ) : rawOutputStream(writer->stream()),
+        debug(writer, DEBUG, minLevel, debugPrefix, timestampPrecision),
+        info(writer, INFO, minLevel, infoPrefix, timestampPrecision),
+        warning(writer, WARNING, minLevel, warningPrefix, timestampPrecision),
+        error(writer, ERROR, minLevel, errorPrefix, timestampPrecision),
+        _factoryMinLevel(minLevel) {
       // empty
     }
+
+   private:
+    std::shared_ptr<const std::atomic<LogLevel>> _factoryMinLevel;
+
+    void useMinLevel(const std::shared_ptr<const std::atomic<LogLevel>>& minLevel) {
+      debug.minLevel(minLevel);
+      info.minLevel(minLevel);
+      warning.minLevel(minLevel);
+      error.minLevel(minLevel);
+    }
   };
 
 } // namespace ulog
+
+// Level-checked logging statements: `ULOG_DEBUG(logger) << expensive();` only evaluates its operands
+// if the line will be written, and compiles down to nothing below ULOG_ACTIVE_LEVEL.
+#define ULOG_LOG_IF_ENABLED_(logger, stream, level) \
+  if (!(ULOG_ACTIVE_LEVEL <= (level) && (logger).stream.enabled())) {} else (logger).stream
+
+#define ULOG_DEBUG(logger)   ULOG_LOG_IF_ENABLED_(logger, debug, ULOG_LEVEL_DEBUG)
+#define ULOG_INFO(logger)    ULOG_LOG_IF_ENABLED_(logger, info, ULOG_LEVEL_INFO)
+#define ULOG_WARNING(logger) ULOG_LOG_IF_ENABLED_(logger, warning, ULOG_LEVEL_WARNING)
+#define ULOG_ERROR(logger)   ULOG_LOG_IF_ENABLED_(logger, error, ULOG_LEVEL_ERROR)
@@ -31,19 +31,30 @@ SOFTWARE.
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <string>
 #include <utility>
 #include <memory>
 #include <mutex>
-
+#include <optional>
+#include <vector>
+
+#include "flight_recorder.h"
+#include "flush_policy.h"
+#include "formatted_line.h"
+#include "log_level.h"
+#include "log_sink.h"
+#include "logger_metrics.h"
 #include "logger.h"
+#include "logger_registry.h"
 
 namespace ulog {
 
   class LogsObserver;
 
-  enum LogLevel { DEBUG, INFO, WARNING, ERROR };
-
   class LoggerFactory {
    public:
     LoggerFactory(
@@ -55,24 +66,16 @@ namespace ulog {
       const bool useAnsiEscape,
       const int loggerNamePadding,
       const bool threadSafe
-    ) : _outputStream(outputStream),
-        _alwaysFlush(alwaysFlush),
-        _callback(callback),
-        _appName(appName),
-        _formattedAppName(formatAppName(appName, useAnsiEscape)),
-        _debugTag(std::move(debugTag)),
-        _infoTag(std::move(infoTag)),
-        _warningTag(std::move(warningTag)),
-        _errorTag(std::move(errorTag)),
-        _useAnsiEscape(useAnsiEscape),
-        _loggerNamePadding(loggerNamePadding),
-        _streamMutex(new std::mutex()),
-        _callbackMutex(new std::mutex()),
-        _threadSafe(threadSafe),
-        logger(create("LoggerFactory", "\033[31;1m")) {
-      if (!threadSafe) {
-        logger.warning << "Thread safety is disabled";
-      }
+    ) : LoggerFactory(
+        outputStream, std::make_shared<OstreamSink>(*outputStream),
+        alwaysFlush ? FlushPolicy::always() : FlushPolicy::never(),
+        callback,
+        appName,
+        std::move(debugTag), std::move(infoTag), std::move(warningTag), std::move(errorTag),
+        useAnsiEscape,
+        loggerNamePadding,
+        threadSafe) {
+      // empty
     }
 
     LoggerFactory(
@@ -111,14 +114,48 @@ namespace ulog {
       // empty
     }
 
+    // Writes to `sink` (e.g. an MmapFileSink) instead of a std::ostream; the sink must outlive the
+    // factory and the loggers it creates.
+    LoggerFactory(
+      LogSink* sink,
+      const std::string& appName,
+      LogsObserver* callback,
+      const bool alwaysFlush,
+      const bool useAnsiEscape = DEFAULT_USE_ANSI_ESCAPE,
+      const int loggerNamePadding = DEFAULT_LOGGER_NAME_PADDING
+    ) : LoggerFactory(
+        nullptr, unownedSink(sink),
+        alwaysFlush ? FlushPolicy::always() : FlushPolicy::never(),
+        callback,
+        appName,
+        formatLogLevel(DEBUG, useAnsiEscape),
+        formatLogLevel(INFO, useAnsiEscape),
+        formatLogLevel(WARNING, useAnsiEscape),
+        formatLogLevel(ERROR, useAnsiEscape),
+        useAnsiEscape,
+        loggerNamePadding,
+        true) {
+      // empty
+    }
+
+    LoggerFactory(LogSink* sink, const std::string& appName, LogsObserver* callback)
+        : LoggerFactory(sink, appName, callback, false,  true) {
+      // empty
+    }
+
+    explicit LoggerFactory(LogSink* sink, const std::string& appName = DEFAULT_APP_NAME)
+        : LoggerFactory(sink, appName, nullptr) {
+      // empty
+    }
+
     static LoggerFactory factoryFrom(
       std::ostream* newOutputStream,
       const LoggerFactory& baseFactory,
       LogsObserver* newCallback
     ) {
-      return {
-        newOutputStream,
-        baseFactory._alwaysFlush,
+      LoggerFactory factory {
+        newOutputStream, std::make_shared<OstreamSink>(*newOutputStream),
+        baseFactory._flushPolicy,
         newCallback,
         baseFactory._appName,
         baseFactory._debugTag, baseFactory._infoTag, baseFactory._warningTag, baseFactory._errorTag,
@@ -126,65 +163,363 @@ namespace ulog {
         baseFactory._loggerNamePadding,
         baseFactory._threadSafe
       };
+      factory.timestampPrecision(baseFactory._timestampPrecision);
+      factory.minLevel(baseFactory.minLevel());
+      factory.binaryMode(baseFactory._binaryMode);
+      factory.jsonMode(baseFactory._jsonMode);
+      factory.asyncMode(baseFactory._asyncQueueCapacity, baseFactory._queueFullPolicy, baseFactory._blockTimeout);
+      factory.collectMetrics(baseFactory.collectsMetrics());
+      factory.threadBuffering(baseFactory._threadBufferSize, baseFactory._threadBufferDelay);
+      factory.coalesceDuplicates(baseFactory._coalesceWindow);
+      factory.clock(baseFactory._clock);
+      factory._sinks = baseFactory._sinks;
+      factory.resetWriter();
+      if (baseFactory._flightRecorder != nullptr) {
+        factory.flightRecorder(
+          baseFactory._flightRecorder->capacity(), baseFactory._flightRecorder->level(), baseFactory._flightRecorder->slotSize()
+        );
+      }
+      return factory;
     }
 
 //// Factory methods
     Logger create(const std::string& loggerName, const std::string& ansiEscape = "") const {
       const auto formattedLoggerName = formatLoggerName(loggerName, ansiEscape, _useAnsiEscape, _loggerNamePadding);
+      const auto names = jsonNames(loggerName);
       return {
-        *_outputStream,
-        _alwaysFlush,
-        _callback,
-        _formattedAppName, formattedLoggerName,
-        _debugTag, _infoTag, _warningTag, _errorTag,
-        _threadSafe ? _streamMutex : nullptr,
-        _threadSafe ? _callbackMutex : nullptr
+        _writer,
+        _minLevel,
+        linePrefix(DEBUG, formattedLoggerName, names),
+        linePrefix(INFO, formattedLoggerName, names),
+        linePrefix(WARNING, formattedLoggerName, names),
+        linePrefix(ERROR, formattedLoggerName, names),
+        _timestampPrecision
       };
     }
 
     std::unique_ptr<Logger> createUnique(const std::string& loggerName, const std::string& ansiEscape = "") const {
       const auto formattedLoggerName = formatLoggerName(loggerName, ansiEscape, _useAnsiEscape, _loggerNamePadding);
+      const auto names = jsonNames(loggerName);
       return std::unique_ptr<Logger>(new Logger(
-        *_outputStream,
-        _alwaysFlush,
-        _callback,
-        _formattedAppName, formattedLoggerName,
-        _debugTag, _infoTag, _warningTag, _errorTag,
-        _threadSafe ? _streamMutex : nullptr,
-        _threadSafe ? _callbackMutex : nullptr
+        _writer,
+        _minLevel,
+        linePrefix(DEBUG, formattedLoggerName, names),
+        linePrefix(INFO, formattedLoggerName, names),
+        linePrefix(WARNING, formattedLoggerName, names),
+        linePrefix(ERROR, formattedLoggerName, names),
+        _timestampPrecision
       ));
     }
 
+    // Returns a handle to the logger shared by all the callers asking for the same name (and ANSI
+    // escape), e.g. for per-connection or per-request loggers: once created, this is a hash lookup,
+    // and the handles are two pointers wide. The logger lives as long as its handles; changing the
+    // factory's settings makes the following calls create new loggers, as `create` would.
+    LoggerHandle createShared(const std::string_view loggerName, const std::string_view ansiEscape = "") const {
+      const auto create = [&] {
+        return std::shared_ptr<const Logger>(createUnique(std::string(loggerName), std::string(ansiEscape)));
+      };
+      if (ansiEscape.empty()) {
+        return LoggerHandle(_loggers->get(loggerName, create));
+      }
+      std::string key;
+      key.append(loggerName).append(1, '\0').append(ansiEscape);
+      return LoggerHandle(_loggers->get(key, create));
+    }
+
+    // Blocks until everything logged so far by loggers created with the current settings has been
+    // written and the output flushed, and delivered to the observers added with `addObserver`.
+    void flush() const {
+      _writer->flush();
+      _observers->flush();
+    }
+
+//// Observers
+    // Delivers the lines at or above `minLevel` of all the loggers of this factory (including the
+    // existing ones) to `observer`, on a thread of its own through a queue of `queueCapacity` lines.
+    // A slow observer doesn't slow down logging: it misses the lines that don't fit in its queue
+    // (see `droppedObserverMessages`). Unlike the LogsObserver passed to the constructor, it gets
+    // `onLogRecord` calls. The observer must stay alive until removed or the factory and its loggers
+    // are destroyed.
+    void addObserver(
+      LogsObserver* observer,
+      const LogLevel minLevel = DEBUG,
+      const size_t queueCapacity = ObserverRegistry::DEFAULT_QUEUE_CAPACITY
+    ) {
+      _observers->add(observer, minLevel, queueCapacity);
+    }
+
+    // Stops the deliveries to `observer`, once the lines already queued for it are delivered.
+    bool removeObserver(LogsObserver* observer) {
+      return _observers->remove(observer);
+    }
+
+    [[nodiscard]] uint64_t droppedObserverMessages(const LogsObserver* observer) const {
+      return _observers->droppedCount(observer);
+    }
+
+//// Sinks
+    // Loggers created afterwards also write to `sink`, the lines at or above `minLevel` (on top of
+    // the factory's minimum level), rendered in `format`: e.g. colored text to the console and plain
+    // text or JSON lines to a file. Each line is formatted once, and each sink's variant derived from
+    // it. Every sink has its own mutex, and follows the factory's other settings (flush policy, async
+    // mode...); the observers only get the lines of the factory's own output. Not available in binary
+    // mode. The sink must outlive the factory and the loggers it creates.
+    void addSink(LogSink* sink, const LogLevel minLevel = DEBUG, const SinkFormat format = TEXT) {
+      _sinks.push_back({unownedSink(sink), minLevel, format, std::make_shared<std::mutex>()});
+      resetWriter();
+    }
+
+    void addSink(std::ostream* stream, const LogLevel minLevel = DEBUG, const SinkFormat format = TEXT) {
+      _sinks.push_back({std::make_shared<OstreamSink>(*stream), minLevel, format, std::make_shared<std::mutex>()});
+      resetWriter();
+    }
+
+    // Loggers created afterwards only write to the factory's own output.
+    void clearSinks() {
+      _sinks.clear();
+      resetWriter();
+    }
+
+//// Metrics
+    // Counters and timings of the loggers created since `collectMetrics(true)`, summed over all
+    // threads; the queue and drop counts are those of the loggers created with the current settings.
+    [[nodiscard]] LoggerMetrics::Snapshot metrics() const {
+      LoggerMetrics::Snapshot snapshot = _metrics != nullptr ? _metrics->snapshot() : LoggerMetrics::Snapshot();
+      snapshot.queueDepth = _writer->queueDepth();
+      snapshot.queueCapacity = _writer->queueCapacity();
+      snapshot.droppedMessages = _writer->droppedCount();
+      snapshot.droppedObserverMessages = _observers->droppedCount();
+      return snapshot;
+    }
+
 //// Getter
+    // nullptr when writing to a LogSink
     [[nodiscard]] std::ostream* outputStream() const {
       return _outputStream;
     }
 
+    [[nodiscard]] LogSink* outputSink() const {
+      return _outputSink.get();
+    }
+
     [[nodiscard]] LogsObserver* logsObserver() const {
       return _callback;
     }
 
+    [[nodiscard]] const FlushPolicy& flushPolicy() const {
+      return _flushPolicy;
+    }
+
+    [[nodiscard]] LogLevel minLevel() const {
+      return _minLevel->load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] bool binaryMode() const {
+      return _binaryMode;
+    }
+
+    [[nodiscard]] bool jsonMode() const {
+      return _jsonMode;
+    }
+
+    [[nodiscard]] bool asyncMode() const {
+      return _asyncQueueCapacity > 0;
+    }
+
+    [[nodiscard]] bool collectsMetrics() const {
+      return _metrics != nullptr;
+    }
+
+    [[nodiscard]] bool threadBuffering() const {
+      return _threadBufferSize > 0;
+    }
+
+    [[nodiscard]] bool hasFlightRecorder() const {
+      return _flightRecorder != nullptr;
+    }
+
+    [[nodiscard]] bool coalescesDuplicates() const {
+      return _coalesceWindow > LogWriter::NO_COALESCING;
+    }
+
+    // nullptr for std::chrono::system_clock
+    [[nodiscard]] const std::shared_ptr<LogClock>& clock() const {
+      return _clock;
+    }
+
+//// Flight recorder
+    // Writes the lines below the minimum level that the flight recorder kept since its last dump.
+    void dumpFlightRecorder() {
+      _writer->dumpFlightRecorder();
+    }
+
+#if !defined(_WIN32)
+    // On SIGSEGV or SIGABRT, writes the whole flight recorder to `fd`, with async-signal-safe calls
+    // only. False without a flight recorder, or if too many are registered; see FlightRecorder.
+    bool dumpFlightRecorderOnCrash(const int fd = STDERR_FILENO) {
+      return _flightRecorder != nullptr && _flightRecorder->dumpOnCrash(fd);
+    }
+#endif
+
+    // Lines dropped so far by loggers created with the current settings because the queue was full.
+    [[nodiscard]] uint64_t droppedMessages() const {
+      return _writer->droppedCount();
+    }
+
 //// Setter
     void outputStream(std::ostream* newStream) {
       _outputStream = newStream;
+      _outputSink = std::make_shared<OstreamSink>(*newStream);
+      resetWriter();
+    }
+
+    void outputSink(LogSink* newSink) {
+      _outputStream = nullptr;
+      _outputSink = unownedSink(newSink);
+      resetWriter();
+    }
+
+    // When the loggers created afterwards flush the output (replaces `alwaysFlush`), e.g.
+    // `FlushPolicy().every(std::chrono::milliseconds(200)).atLevel(WARNING)`.
+    void flushPolicy(const FlushPolicy flushPolicy) {
+      _flushPolicy = flushPolicy;
+      resetWriter();
     }
 
     void loggerNamePadding(const int loggerNamePadding) {
       _loggerNamePadding = loggerNamePadding;
+      _loggers = std::make_shared<LoggerRegistry>();
+    }
+
+    // Lines below `minLevel` are discarded before anything is formatted. Unlike the other settings,
+    // this also applies to the loggers already created (except those with their own minimum level).
+    void minLevel(const LogLevel minLevel) {
+      _minLevel->store(minLevel, std::memory_order_relaxed);
+    }
+
+    // Number of fractional digits of the seconds in the timestamps (milli, micro or nanoseconds).
+    void timestampPrecision(const TimestampPrecision timestampPrecision) {
+      _timestampPrecision = timestampPrecision;
+      _loggers = std::make_shared<LoggerRegistry>();
     }
 
     void threadSafe(const bool threadSafe) {
       _threadSafe = threadSafe;
+      resetWriter();
       if (!threadSafe) {
-        logger.warning << "Thread safety is disabled";
+        logger->warning << "Thread safety is disabled";
+      }
+    }
+
+    // Loggers created afterwards write compact BinaryLog records instead of text lines: no text
+    // formatting on the logging thread, and the static part of each line (app name, level, logger
+    // name) is written once per logger instead of once per line. The output stream must be opened
+    // in binary mode, and only contain binary records (`rawOutputStream` must not be used);
+    // `tools/ulog_decode` turns it back into the usual text. The LogsObserver still gets text.
+    void binaryMode(const bool binaryMode) {
+      _binaryMode = binaryMode;
+      resetWriter();
+    }
+
+    // Loggers created afterwards write one JSON object per line (JSON lines), e.g.
+    // `{"time":"2025-01-31 12:00:00.123","level":"INFO","app":"MyApp","logger":"Server","msg":"Started","port":8080}`
+    // with the key-value fields added with `kv`. Strings are escaped without going through
+    // std::ostream, and there are no ANSI escapes. Ignored in binary mode.
+    void jsonMode(const bool jsonMode) {
+      _jsonMode = jsonMode;
+      resetWriter();
+    }
+
+    // Loggers created afterwards only push finished lines into a bounded lock-free queue of
+    // `queueCapacity` entries; a background thread writes them to the stream and the LogsObserver.
+    // The queue is drained once the factory and all the loggers using it have been destroyed, or
+    // on `flush()`. A capacity of 0 goes back to writing on the calling thread.
+    //
+    // `queueFullPolicy` picks between completeness and latency when the queue is full: BLOCK waits
+    // up to `blockTimeout` for room, DROP_NEWEST and DROP_OLDEST never wait. Dropped lines are
+    // counted and reported by a single warning line once the queue has room again.
+    void asyncMode(
+      const size_t queueCapacity,
+      const QueueFullPolicy queueFullPolicy = BLOCK,
+      const std::chrono::milliseconds blockTimeout = LogWriter::BLOCK_FOREVER
+    ) {
+      _asyncQueueCapacity = queueCapacity;
+      _queueFullPolicy = queueFullPolicy;
+      _blockTimeout = blockTimeout;
+      resetWriter();
+    }
+
+    // Loggers created afterwards count their lines and bytes per level, and time the waits for the
+    // stream and LogsObserver mutexes and the sink's writes and flushes (see `metrics()`). Costs a
+    // few relaxed increments per line, and a couple of clock reads per lock and sink call.
+    void collectMetrics(const bool collectMetrics) {
+      if (collectMetrics == collectsMetrics()) {
+        return;
       }
+      _metrics = collectMetrics ? std::make_shared<LoggerMetrics>() : nullptr;
+      resetWriter();
+    }
+
+    // Loggers created afterwards append their lines to a buffer per thread, written to the output
+    // under the stream mutex once it holds `bufferSize` bytes, or after `maxDelay`; a line at ERROR
+    // (or one the FlushPolicy flushes at), `flush()` and the thread's exit write it out right away.
+    // Trades a little latency for taking the stream mutex once per batch instead of once per line.
+    // Only with thread safety and in synchronous mode; a size of 0 turns it off.
+    void threadBuffering(
+      const size_t bufferSize,
+      const std::chrono::milliseconds maxDelay = LogWriter::DEFAULT_THREAD_BUFFER_DELAY
+    ) {
+      _threadBufferSize = bufferSize;
+      _threadBufferDelay = maxDelay;
+      resetWriter();
+    }
+
+    // Loggers created afterwards also keep their last `capacity` lines at or above `level` in memory,
+    // including those below the minimum level, in preallocated slots of `slotSize` bytes. The lines
+    // below the minimum level are only written before a line at ERROR (those recorded since the
+    // previous dump), or on `dumpFlightRecorder()`. Not available in binary mode; a capacity of 0
+    // turns it off.
+    void flightRecorder(
+      const size_t capacity,
+      const LogLevel level = DEBUG,
+      const size_t slotSize = FlightRecorder::DEFAULT_SLOT_SIZE
+    ) {
+      _flightRecorder = capacity > 0 ? std::make_shared<FlightRecorder>(capacity, level, slotSize) : nullptr;
+      resetWriter();
+    }
+
+    // Loggers created afterwards write a run of identical lines (timestamp aside) once, followed by
+    // a "Last message repeated N times" line when a different line comes, on `flush()`, and every
+    // `window` while the run goes on; see DuplicateCoalescer. Costs comparing each line with the
+    // previous one under a mutex (see bench/coalesce_bench). Off by default, as it changes what is
+    // written. Not available in binary mode; a window of 0 turns it off.
+    void coalesceDuplicates(const std::chrono::milliseconds window = DuplicateCoalescer::DEFAULT_WINDOW) {
+      _coalesceWindow = window;
+      resetWriter();
+    }
+
+    // Loggers created afterwards take the timestamps of their lines from `clock`, e.g. a TscClock
+    // (reading the CPU's cycle counter) shared between factories; nullptr for std::chrono::system_clock.
+    void clock(std::shared_ptr<LogClock> clock) {
+      _clock = std::move(clock);
+      resetWriter();
     }
 
    private:
+    struct AddedSink {
+      std::shared_ptr<LogSink>    sink;
+      LogLevel                    minLevel;
+      SinkFormat                  format;
+      std::shared_ptr<std::mutex> mutex;
+    };
+
     std::ostream*   _outputStream;
-    bool            _alwaysFlush;
+    std::shared_ptr<LogSink> _outputSink;
+    FlushPolicy     _flushPolicy;
 
     LogsObserver*   _callback;
+    std::shared_ptr<ObserverRegistry> _observers;
 
     std::string     _appName;
     std::string     _formattedAppName;
@@ -202,10 +537,184 @@ namespace ulog {
 
     bool            _threadSafe;
 
-    Logger          logger;
+    TimestampPrecision _timestampPrecision;
+    std::shared_ptr<std::atomic<LogLevel>> _minLevel;
+
+    bool            _binaryMode;
+    bool            _jsonMode;
+
+    size_t          _asyncQueueCapacity;
+    QueueFullPolicy _queueFullPolicy;
+    std::chrono::milliseconds _blockTimeout;
+    std::shared_ptr<LoggerMetrics> _metrics; // nullptr unless collecting metrics
+    size_t          _threadBufferSize;
+    std::chrono::milliseconds _threadBufferDelay;
+    std::shared_ptr<FlightRecorder> _flightRecorder; // nullptr without a flight recorder
+    std::chrono::milliseconds _coalesceWindow;
+    std::shared_ptr<LogClock> _clock; // nullptr for std::chrono::system_clock
+    std::vector<AddedSink> _sinks;
+    std::shared_ptr<LogWriter> _writer;
+    std::shared_ptr<LoggerRegistry> _loggers; // createShared's, for the current settings
+
+    std::optional<Logger> logger; // rebuilt with the writer
+
+    LoggerFactory(
+      std::ostream* outputStream,
+      std::shared_ptr<LogSink> outputSink,
+      const FlushPolicy flushPolicy,
+      LogsObserver* callback,
+      const std::string& appName,
+      std::string debugTag, std::string infoTag, std::string warningTag, std::string errorTag,
+      const bool useAnsiEscape,
+      const int loggerNamePadding,
+      const bool threadSafe
+    ) : _outputStream(outputStream),
+        _outputSink(std::move(outputSink)),
+        _flushPolicy(flushPolicy),
+        _callback(callback),
+        _observers(std::make_shared<ObserverRegistry>()),
+        _appName(appName),
+        _formattedAppName(formatAppName(appName, useAnsiEscape)),
+        _debugTag(std::move(debugTag)),
+        _infoTag(std::move(infoTag)),
+        _warningTag(std::move(warningTag)),
+        _errorTag(std::move(errorTag)),
+        _useAnsiEscape(useAnsiEscape),
+        _loggerNamePadding(loggerNamePadding),
+        _streamMutex(new std::mutex()),
+        _callbackMutex(new std::mutex()),
+        _threadSafe(threadSafe),
+        _timestampPrecision(MILLISECONDS),
+        _minLevel(std::make_shared<std::atomic<LogLevel>>(DEBUG)),
+        _binaryMode(false),
+        _jsonMode(false),
+        _asyncQueueCapacity(0),
+        _queueFullPolicy(BLOCK),
+        _blockTimeout(LogWriter::BLOCK_FOREVER),
+        _metrics(nullptr),
+        _threadBufferSize(0),
+        _threadBufferDelay(LogWriter::DEFAULT_THREAD_BUFFER_DELAY),
+        _flightRecorder(nullptr),
+        _coalesceWindow(LogWriter::NO_COALESCING),
+        _clock(nullptr),
+        _sinks(),
+        _writer(makeWriter()),
+        _loggers(std::make_shared<LoggerRegistry>()),
+        logger(create(FACTORY_LOGGER_NAME, FACTORY_LOGGER_ANSI_ESCAPE)) {
+      if (!threadSafe) {
+        logger->warning << "Thread safety is disabled";
+      }
+    }
+
+    static std::shared_ptr<LogSink> unownedSink(LogSink* sink) {
+      return {sink, [](LogSink*) {}};
+    }
+
+    // After a change of the output settings; the factory's own logger writes to the new writer too.
+    void resetWriter() {
+      _writer = makeWriter();
+      _loggers = std::make_shared<LoggerRegistry>();
+      logger.emplace(create(FACTORY_LOGGER_NAME, FACTORY_LOGGER_ANSI_ESCAPE));
+    }
+
+    std::shared_ptr<LogWriter> makeWriter() const {
+      LogWriter::Options options;
+      options.sink = _outputSink;
+      options.flushPolicy = _flushPolicy;
+      options.callback = _callback;
+      options.observers = _observers;
+      options.streamMutex = _threadSafe ? _streamMutex : nullptr;
+      options.callbackMutex = _threadSafe ? _callbackMutex : nullptr;
+      options.asyncQueueCapacity = _asyncQueueCapacity;
+      options.queueFullPolicy = _queueFullPolicy;
+      options.blockTimeout = _blockTimeout;
+      options.formatNotice = noticeFormatter(_jsonMode && !_binaryMode);
+      options.binary = _binaryMode;
+      options.json = _jsonMode;
+      options.metrics = _metrics;
+      options.threadBufferSize = _threadBufferSize;
+      options.threadBufferDelay = _threadBufferDelay;
+      options.flightRecorder = _flightRecorder;
+      options.routes = makeRoutes();
+      options.coalesceWindow = _coalesceWindow;
+      options.clock = _clock;
+      return std::make_shared<LogWriter>(std::move(options));
+    }
+
+    // The added sinks' writers: no observers, metrics, flight recorder or coalescing of their own.
+    std::vector<LogWriter::Route> makeRoutes() const {
+      std::vector<LogWriter::Route> routes;
+      for (const AddedSink& added : _sinks) {
+        LogWriter::Options options;
+        options.sink = added.sink;
+        options.flushPolicy = _flushPolicy;
+        options.streamMutex = _threadSafe ? added.mutex.get() : nullptr;
+        options.asyncQueueCapacity = _asyncQueueCapacity;
+        options.queueFullPolicy = _queueFullPolicy;
+        options.blockTimeout = _blockTimeout;
+        options.formatNotice = noticeFormatter(added.format == JSON_LINES);
+        options.json = added.format == JSON_LINES;
+        options.threadBufferSize = _threadBufferSize;
+        options.threadBufferDelay = _threadBufferDelay;
+        routes.push_back({std::make_shared<LogWriter>(std::move(options)), added.minLevel, added.format, added.mutex});
+      }
+      return routes;
+    }
+
+    // JSON mode, or a sink writing JSON lines: the static fields of the lines of `loggerName`'s loggers.
+    std::string jsonNames(const std::string& loggerName) const {
+      const bool json = _jsonMode || std::any_of(_sinks.begin(), _sinks.end(), [](const AddedSink& added) {
+        return added.format == JSON_LINES;
+      });
+      return json && !_binaryMode ? JsonFormatter::names(_appName, loggerName) : "";
+    }
+
+    const std::string& levelTag(const LogLevel level) const {
+      switch (level) {
+        case DEBUG:   return _debugTag;
+        case INFO:    return _infoTag;
+        case WARNING: return _warningTag;
+        case ERROR:   return _errorTag;
+      }
+      return _errorTag; // unreachable, but don't remove - needed with GCC -Werror
+    }
+
+    std::shared_ptr<const LinePrefix> linePrefix(
+      const LogLevel level,
+      const std::string& formattedLoggerName,
+      const std::string& jsonNames
+    ) const {
+      return LinePrefix::make(
+        _formattedAppName, levelTag(level), formattedLoggerName,
+        jsonNames.empty() ? "" : JsonFormatter::header(level, jsonNames)
+      );
+    }
+
+    // Formats the writer's own notices (e.g. dropped lines) as warnings from "LoggerFactory".
+    std::function<std::string(const std::string&)> noticeFormatter(const bool json) const {
+      return [
+        json,
+        prefix = linePrefix(
+          WARNING,
+          formatLoggerName(FACTORY_LOGGER_NAME, FACTORY_LOGGER_ANSI_ESCAPE, _useAnsiEscape, _loggerNamePadding),
+          jsonNames(FACTORY_LOGGER_NAME)
+        ),
+        timestampPrecision = _timestampPrecision,
+        clock = _clock
+      ](const std::string& message) {
+        const auto formattedTime = LogStream::formatCurrentTime(
+          clock != nullptr ? clock->now() : LogStream::getCurrentTime(), timestampPrecision
+        );
+        return json
+          ? LogMessageBuilder::formatJsonLine(*prefix, formattedTime, message)
+          : LogMessageBuilder::formatLine(*prefix, formattedTime, message);
+      };
+    }
 
 //// Formatting
     static constexpr auto* DEFAULT_APP_NAME = "";
+    static constexpr auto* FACTORY_LOGGER_NAME = "LoggerFactory";
+    static constexpr auto* FACTORY_LOGGER_ANSI_ESCAPE = "\033[31;1m";
     static constexpr bool DEFAULT_USE_ANSI_ESCAPE = true;
     static constexpr int DEFAULT_LOGGER_NAME_PADDING = 16;
 
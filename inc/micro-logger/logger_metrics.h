@@ -0,0 +1,189 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "log_level.h"
+
+namespace ulog {
+
+  // Self-instrumentation of a LoggerFactory (see LoggerFactory::collectMetrics): lines and bytes
+  // per level, and how long the logging and writer threads spend waiting for the stream and
+  // LogsObserver mutexes and inside the sink's write and flush.
+  //
+  // Counters are split into 16 cache-line-aligned shards of relaxed atomics, handed out to threads
+  // round-robin on their first record: with up to 16 recording threads, each one has a shard to
+  // itself; beyond that, threads share shards (every 16th thread the same one), which stays correct
+  // but can contend. `snapshot()` adds the shards up.
+  class LoggerMetrics {
+  public:
+    static constexpr size_t LEVEL_COUNT = ULOG_LEVEL_OFF;
+
+    // Bucket 0 holds 0ns, bucket i (i > 0) [2^(i-1), 2^i) ns; the last one everything above.
+    static constexpr size_t HISTOGRAM_BUCKETS = 40;
+
+    enum Timer {
+      STREAM_LOCK_WAIT,
+      CALLBACK_LOCK_WAIT,
+      SINK_WRITE,
+      SINK_FLUSH,
+      TIMER_COUNT
+    };
+
+    struct Histogram {
+      uint64_t count = 0;
+      uint64_t totalNanoseconds = 0;
+      std::array<uint64_t, HISTOGRAM_BUCKETS> buckets{};
+
+      [[nodiscard]] double meanNanoseconds() const {
+        return count == 0 ? 0 : static_cast<double>(totalNanoseconds) / static_cast<double>(count);
+      }
+
+      // Upper bound of the bucket holding the `fraction` quantile, e.g. percentileNanoseconds(0.99).
+      [[nodiscard]] uint64_t percentileNanoseconds(const double fraction) const {
+        const auto rank = static_cast<uint64_t>(fraction * static_cast<double>(count));
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket) {
+          seen += buckets[bucket];
+          if (seen > rank) {
+            return bucket == 0 ? 0 : uint64_t(1) << bucket;
+          }
+        }
+        return count == 0 ? 0 : uint64_t(1) << (HISTOGRAM_BUCKETS - 1);
+      }
+    };
+
+    struct Snapshot {
+      std::array<uint64_t, LEVEL_COUNT> messages{}; // indexed by LogLevel
+      std::array<uint64_t, LEVEL_COUNT> bytes{};
+
+      Histogram streamLockWait;
+      Histogram callbackLockWait;
+      Histogram sinkWrite;
+      Histogram sinkFlush;
+
+      // Loggers created with the factory's current settings: lines waiting in the async queue (0
+      // in synchronous mode), lines dropped by the QueueFullPolicy, and lines missed by the
+      // observers added with addObserver.
+      size_t   queueDepth = 0;
+      size_t   queueCapacity = 0;
+      uint64_t droppedMessages = 0;
+      uint64_t droppedObserverMessages = 0;
+    };
+
+    LoggerMetrics() = default;
+
+    LoggerMetrics(const LoggerMetrics&) = delete;
+    LoggerMetrics& operator=(const LoggerMetrics&) = delete;
+
+    static std::chrono::steady_clock::time_point now() {
+      return std::chrono::steady_clock::now();
+    }
+
+    void countMessage(const LogLevel level, const size_t bytes) {
+      Shard& shard = threadShard();
+      shard.messages[level].fetch_add(1, std::memory_order_relaxed);
+      shard.bytes[level].fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    // Records the time elapsed since `start` (from `now()`).
+    void record(const Timer timer, const std::chrono::steady_clock::time_point start) {
+      const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now() - start).count();
+      const auto nanoseconds = static_cast<uint64_t>(elapsed > 0 ? elapsed : 0);
+      const size_t bucket = std::min<size_t>(std::bit_width(nanoseconds), HISTOGRAM_BUCKETS - 1);
+
+      ShardHistogram& histogram = threadShard().timers[timer];
+      histogram.count.fetch_add(1, std::memory_order_relaxed);
+      histogram.totalNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+      histogram.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Counters only; the LoggerFactory fills in the queue and drop counts.
+    [[nodiscard]] Snapshot snapshot() const {
+      Snapshot snapshot;
+      for (const Shard& shard : _shards) {
+        for (size_t level = 0; level < LEVEL_COUNT; ++level) {
+          snapshot.messages[level] += shard.messages[level].load(std::memory_order_relaxed);
+          snapshot.bytes[level] += shard.bytes[level].load(std::memory_order_relaxed);
+        }
+        shard.timers[STREAM_LOCK_WAIT].addTo(snapshot.streamLockWait);
+        shard.timers[CALLBACK_LOCK_WAIT].addTo(snapshot.callbackLockWait);
+        shard.timers[SINK_WRITE].addTo(snapshot.sinkWrite);
+        shard.timers[SINK_FLUSH].addTo(snapshot.sinkFlush);
+      }
+      return snapshot;
+    }
+
+  private:
+    static constexpr size_t SHARD_COUNT = 16;
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    struct ShardHistogram {
+      std::atomic<uint64_t> count{0};
+      std::atomic<uint64_t> totalNanoseconds{0};
+      std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS> buckets{};
+
+      void addTo(Histogram& histogram) const {
+        histogram.count += count.load(std::memory_order_relaxed);
+        histogram.totalNanoseconds += totalNanoseconds.load(std::memory_order_relaxed);
+        for (size_t bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket) {
+          histogram.buckets[bucket] += buckets[bucket].load(std::memory_order_relaxed);
+        }
+      }
+    };
+
+    struct alignas(CACHE_LINE_SIZE) Shard {
+      std::array<std::atomic<uint64_t>, LEVEL_COUNT> messages{};
+      std::array<std::atomic<uint64_t>, LEVEL_COUNT> bytes{};
+      std::array<ShardHistogram, TIMER_COUNT>        timers;
+    };
+
+    std::array<Shard, SHARD_COUNT> _shards;
+
+    // A thread's shard is picked once, round-robin, and is the same in all the LoggerMetrics
+    // instances.
+    Shard& threadShard() {
+      static std::atomic<size_t> nextShard{0};
+      thread_local const size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT;
+      return _shards[shard];
+    }
+  };
+
+} // namespace ulog
@@ -0,0 +1,139 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "logger.h"
+
+namespace ulog {
+
+  // Handle to a Logger shared by every handle created for the same name (see
+  // LoggerFactory::createShared): two pointers wide, and copying it is a reference count increment.
+  //
+  //   const ulog::LoggerHandle logger = loggerFactory.createShared("Connection");
+  //   logger->info << "Connected";
+  class LoggerHandle {
+  public:
+    LoggerHandle() = default;
+
+    explicit LoggerHandle(std::shared_ptr<const Logger> logger) : _logger(std::move(logger)) {
+      // empty
+    }
+
+    const Logger* operator->() const {
+      return _logger.get();
+    }
+
+    const Logger& operator*() const {
+      return *_logger;
+    }
+
+    explicit operator bool() const {
+      return _logger != nullptr;
+    }
+
+  private:
+    std::shared_ptr<const Logger> _logger;
+  };
+
+  // Interned loggers of a LoggerFactory, by name: looking up an existing name is a hash lookup
+  // under a shared lock. Loggers are only kept alive by their handles; the entries of the
+  // destroyed ones are swept as the registry grows.
+  class LoggerRegistry {
+  public:
+    LoggerRegistry() = default;
+
+    LoggerRegistry(const LoggerRegistry&) = delete;
+    LoggerRegistry& operator=(const LoggerRegistry&) = delete;
+
+    // Returns the live logger registered under `key`, or registers the one made by `create()`.
+    // `create()` runs without the lock, so lookups of other keys don't wait for it; threads that
+    // miss the same key concurrently each make one, and all but the first registered are discarded
+    // (in binary mode, their site records stay in the output, unused).
+    template <typename Create>
+    std::shared_ptr<const Logger> get(const std::string_view key, Create&& create) {
+      {
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        const auto found = _loggers.find(key);
+        if (found != _loggers.end()) {
+          if (auto logger = found->second.lock()) {
+            return logger;
+          }
+        }
+      }
+
+      std::shared_ptr<const Logger> created = create(); // destroyed after the lock is released, if discarded
+
+      std::unique_lock<std::shared_mutex> lock(_mutex);
+      auto& entry = _loggers[std::string(key)];
+      if (auto logger = entry.lock()) {
+        return logger; // registered by another thread in between
+      }
+      entry = created;
+      if (_loggers.size() >= _sweepSize) {
+        sweep();
+      }
+      return created;
+    }
+
+  private:
+    static constexpr size_t MIN_SWEEP_SIZE = 64;
+
+    struct Hash {
+      using is_transparent = void;
+
+      size_t operator()(const std::string_view key) const {
+        return std::hash<std::string_view>()(key);
+      }
+    };
+
+    std::shared_mutex _mutex;
+    std::unordered_map<std::string, std::weak_ptr<const Logger>, Hash, std::equal_to<>> _loggers;
+    size_t            _sweepSize = MIN_SWEEP_SIZE;
+
+    // Drops the entries of destroyed loggers; amortized by doubling the size of the next sweep.
+    void sweep() {
+      std::erase_if(_loggers, [](const auto& entry) { return entry.second.expired(); });
+      _sweepSize = std::max(MIN_SWEEP_SIZE, 2 * _loggers.size());
+    }
+  };
+
+} // namespace ulog
@@ -31,14 +31,55 @@ SOFTWARE.
 
 #pragma once
 
+#include <cstring>
+#include <memory>
 #include <string>
+#include <string_view>
+
+#include "log_level.h"
 
 namespace ulog {
 
+  // A finished log line, as delivered to the observers added with LoggerFactory::addObserver.
+  // Immutable and reference-counted: the text is allocated once, whatever the number of observers,
+  // and an observer can keep the record without copying it.
+  class LogRecord {
+  public:
+    LogRecord() = default;
+
+    LogRecord(const std::string_view text, const LogLevel level)
+        : _text(std::make_shared_for_overwrite<char[]>(text.size())),
+          _size(text.size()),
+          _level(level) {
+      std::memcpy(_text.get(), text.data(), text.size());
+    }
+
+    // Including the final '\n'.
+    [[nodiscard]] std::string_view text() const {
+      return {_text.get(), _size};
+    }
+
+    [[nodiscard]] LogLevel level() const {
+      return _level;
+    }
+
+  private:
+    std::shared_ptr<char[]> _text;
+    size_t                  _size = 0;
+    LogLevel                _level = DEBUG;
+  };
+
   class LogsObserver {
   public:
+    // Called synchronously for the observer passed to the LoggerFactory constructor.
     virtual void onOutputLogMessage(const std::string& newData) = 0;
 
+    // Called on the observer's own thread when added with LoggerFactory::addObserver; by default,
+    // forwards a copy of the text to `onOutputLogMessage`.
+    virtual void onLogRecord(const LogRecord& record) {
+      onOutputLogMessage(std::string(record.text()));
+    }
+
     virtual ~LogsObserver() = default;
   };
 
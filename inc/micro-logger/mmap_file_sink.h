@@ -0,0 +1,508 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#if defined(_WIN32)
+#error "MmapFileSink is only available on POSIX platforms"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "log_sink.h"
+
+namespace ulog {
+
+  // Writes the logs to a memory-mapped file, rotated by size and/or age.
+  //
+  // Writing a line is a memcpy into the current mapped chunk of the file. A background thread
+  // allocates and maps the next chunk ahead of time, unmaps the used ones, and prepares the next
+  // file (`<path>.next`) so that a rotation is only a pointer swap on the logging thread. Rotated
+  // files are renamed `<path>.1` (most recent) to `<path>.<retainedFiles>`; older ones are deleted.
+  //
+  // The file is extended one chunk at a time and truncated to its content when it is rotated or the
+  // sink destroyed. After a crash, the file may end with NUL bytes: the unused end of the current
+  // chunk, and the next chunk, allocated ahead of time. Those are trimmed when the file is reopened.
+  // Readers following the file (e.g. `tail -f`) should be aware that its size grows before its
+  // content does.
+  //
+  // If the disk is full or a file can't be created, lines are dropped (see `droppedBytes()`)
+  // rather than risking a SIGBUS on an unbacked page; the chunk or file is tried again at most
+  // every `RETRY_INTERVAL`, on the next line that needs it.
+  class MmapFileSink : public LogSink {
+  public:
+    static constexpr uint64_t DEFAULT_MAX_FILE_SIZE = 64 * 1024 * 1024;
+    static constexpr int DEFAULT_RETAINED_FILES = 5;
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 4 * 1024 * 1024;
+    static constexpr auto NO_MAX_FILE_AGE = std::chrono::seconds::zero();
+    static constexpr auto RETRY_INTERVAL = std::chrono::seconds(1);
+
+    explicit MmapFileSink(
+      std::string path,
+      const uint64_t maxFileSize = DEFAULT_MAX_FILE_SIZE,
+      const std::chrono::seconds maxFileAge = NO_MAX_FILE_AGE,
+      const int retainedFiles = DEFAULT_RETAINED_FILES,
+      const size_t chunkSize = DEFAULT_CHUNK_SIZE
+    ) : _path(std::move(path)),
+        _maxFileSize(maxFileSize),
+        _maxFileAge(maxFileAge),
+        _retainedFiles(retainedFiles),
+        _chunkSize(roundToPageSize(chunkSize)) {
+      if (!openCurrentFile()) {
+        fail();
+      }
+      _thread = std::thread(&MmapFileSink::run, this);
+    }
+
+    MmapFileSink(const MmapFileSink&) = delete;
+    MmapFileSink& operator=(const MmapFileSink&) = delete;
+
+    ~MmapFileSink() override {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+        _workCondition.notify_one();
+      }
+      _thread.join();
+
+      releaseRetired();
+      finishFiles();
+      unmap(_chunk);
+      closeFile(_fileFd, _fileWritten);
+      unmap(_nextChunk);
+      if (_nextFile.fd >= 0) {
+        unmap(_nextFile.chunk);
+        ::close(_nextFile.fd);
+        ::unlink(nextFilePath().c_str());
+      }
+    }
+
+    void write(const char* data, size_t size) override {
+      if (_fileWritten > 0
+          && (_fileWritten + size > _maxFileSize || _rotationRequested.load(std::memory_order_relaxed))) {
+        switchFile();
+      }
+
+      while (size > 0) {
+        if (_cursor == _chunkEnd && !nextChunk()) {
+          _droppedBytes.fetch_add(size, std::memory_order_relaxed);
+          return;
+        }
+        const size_t count = std::min(size, static_cast<size_t>(_chunkEnd - _cursor));
+        std::memcpy(_cursor, data, count);
+        _cursor += count;
+        _fileWritten += count;
+        data += count;
+        size -= count;
+      }
+    }
+
+    // The data is in the page cache as soon as it's written, so it survives a crash of the process;
+    // this only starts writing the current chunk back to the disk.
+    void flush() override {
+      if (_chunk.data != nullptr) {
+        ::msync(_chunk.data, _chunk.size, MS_ASYNC);
+      }
+    }
+
+    // Rotates the file before the next line.
+    void rotate() {
+      _rotationRequested.store(true, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] bool isOpen() const {
+      return _fileFd >= 0;
+    }
+
+    [[nodiscard]] uint64_t droppedBytes() const {
+      return _droppedBytes.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] const std::string& path() const {
+      return _path;
+    }
+
+  private:
+    struct Mapping {
+      char*    data = nullptr;
+      size_t   size = 0;
+      uint64_t offset = 0; // in the file
+    };
+
+    struct PreparedFile {
+      int     fd = -1;
+      Mapping chunk;
+    };
+
+    struct FinishedFile {
+      int      fd;
+      uint64_t size;
+    };
+
+    std::string               _path;
+    uint64_t                  _maxFileSize;
+    std::chrono::seconds      _maxFileAge;
+    int                       _retainedFiles;
+    size_t                    _chunkSize;
+
+    //// Logging thread
+    int                       _fileFd = -1;
+    uint64_t                  _fileWritten = 0;
+    Mapping                   _chunk;
+    char*                     _cursor = nullptr;
+    char*                     _chunkEnd = nullptr;
+
+    std::atomic<bool>         _rotationRequested{false};
+    std::atomic<uint64_t>     _droppedBytes{0};
+
+    //// Shared with the background thread, under _mutex
+    std::mutex                _mutex;
+    std::condition_variable   _workCondition;
+    std::condition_variable   _readyCondition;
+    bool                      _stopping = false;
+    bool                      _failed = false;   // the next chunk or file could not be prepared
+    std::chrono::steady_clock::time_point _failedAt;
+    uint64_t                  _generation = 0;   // incremented on every rotation
+    uint64_t                  _nextChunkOffset = 0;
+    Mapping                   _nextChunk;        // of the current file
+    PreparedFile              _nextFile;
+    std::vector<Mapping>      _retired;          // to unmap
+    std::vector<FinishedFile> _finished;         // to truncate, close and rename
+    std::chrono::system_clock::time_point _fileOpenedAt;
+
+    std::thread               _thread;
+
+//// Logging thread
+    bool nextChunk() {
+      std::unique_lock<std::mutex> lock(_mutex);
+      if (_chunk.data != nullptr) {
+        _retired.push_back(_chunk);
+        _chunk = {};
+        _cursor = _chunkEnd = nullptr;
+      }
+      if (_nextChunk.data == nullptr && !mayRetry()) {
+        return false;
+      }
+      if (_fileFd < 0) { // opening the file failed
+        if (!openCurrentFile()) {
+          fail();
+          return false;
+        }
+        _workCondition.notify_one();
+        return true;
+      }
+      _workCondition.notify_one();
+      _readyCondition.wait(lock, [&] { return _nextChunk.data != nullptr || _failed || _stopping; });
+      if (_nextChunk.data == nullptr) {
+        return false;
+      }
+      useChunk(_nextChunk);
+      _nextChunk = {};
+      _nextChunkOffset = _chunk.offset + _chunkSize;
+      _workCondition.notify_one();
+      return true;
+    }
+
+    void switchFile() {
+      _rotationRequested.store(false, std::memory_order_relaxed);
+      std::unique_lock<std::mutex> lock(_mutex);
+      if (_nextFile.fd < 0 && !mayRetry()) {
+        return; // keep writing to the current file
+      }
+      _workCondition.notify_one();
+      _readyCondition.wait(lock, [&] { return _nextFile.fd >= 0 || _failed || _stopping; });
+      if (_nextFile.fd < 0) {
+        return; // keep writing to the current file
+      }
+
+      _finished.push_back({_fileFd, _fileWritten});
+      if (_chunk.data != nullptr) {
+        _retired.push_back(_chunk);
+      }
+      if (_nextChunk.data != nullptr) {
+        _retired.push_back(_nextChunk);
+        _nextChunk = {};
+      }
+      ++_generation;
+
+      _fileFd = _nextFile.fd;
+      _fileWritten = 0;
+      _fileOpenedAt = std::chrono::system_clock::now();
+      useChunk(_nextFile.chunk);
+      _nextFile = {};
+      _nextChunkOffset = _chunkSize;
+      _workCondition.notify_one();
+    }
+
+    // Under _mutex. After a failure, clears it if RETRY_INTERVAL has passed, e.g. for disk space
+    // freed in the meantime.
+    bool mayRetry() {
+      if (!_failed) {
+        return true;
+      }
+      if (std::chrono::steady_clock::now() - _failedAt < RETRY_INTERVAL) {
+        return false;
+      }
+      _failed = false;
+      return true;
+    }
+
+    // Under _mutex
+    void fail() {
+      _failed = true;
+      _failedAt = std::chrono::steady_clock::now();
+    }
+
+    void useChunk(const Mapping& chunk) {
+      _chunk = chunk;
+      _cursor = chunk.data + (_fileWritten - chunk.offset);
+      _chunkEnd = chunk.data + chunk.size;
+    }
+
+//// Background thread
+    void run() {
+      std::unique_lock<std::mutex> lock(_mutex);
+      while (!_stopping) {
+        if (!_retired.empty() || !_finished.empty()) {
+          lock.unlock();
+          releaseRetired();
+          finishFiles();
+          lock.lock();
+          continue;
+        }
+
+        if (_nextChunk.data == nullptr && _fileFd >= 0 && !_failed) {
+          const int fd = _fileFd;
+          const uint64_t offset = _nextChunkOffset;
+          const uint64_t generation = _generation;
+          lock.unlock();
+          const Mapping chunk = mapChunk(fd, offset);
+          lock.lock();
+          if (chunk.data == nullptr) {
+            fail();
+          } else if (generation != _generation) {
+            _retired.push_back(chunk); // the file was rotated in the meantime
+          } else {
+            _nextChunk = chunk;
+          }
+          _readyCondition.notify_all();
+          continue;
+        }
+
+        if (_nextFile.fd < 0 && !_failed) {
+          lock.unlock();
+          const PreparedFile file = prepareFile();
+          lock.lock();
+          if (file.fd < 0) {
+            fail();
+          } else {
+            _nextFile = file;
+          }
+          _readyCondition.notify_all();
+          continue;
+        }
+
+        if (_maxFileAge == NO_MAX_FILE_AGE) {
+          _workCondition.wait(lock);
+        } else {
+          const auto rotationTime = _fileOpenedAt + _maxFileAge;
+          if (std::chrono::system_clock::now() >= rotationTime) {
+            _rotationRequested.store(true, std::memory_order_relaxed);
+            _workCondition.wait(lock);
+          } else {
+            _workCondition.wait_until(lock, rotationTime);
+          }
+        }
+      }
+      _readyCondition.notify_all();
+    }
+
+    void releaseRetired() {
+      std::vector<Mapping> retired;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        retired.swap(_retired);
+      }
+      for (Mapping& mapping : retired) {
+        unmap(mapping);
+      }
+    }
+
+    // Truncates the rotated files to their content and shifts the names of the retained files.
+    void finishFiles() {
+      std::vector<FinishedFile> finished;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        finished.swap(_finished);
+      }
+      for (const FinishedFile& file : finished) {
+        closeFile(file.fd, file.size);
+
+        if (_retainedFiles > 0) {
+          std::remove(rotatedFilePath(_retainedFiles).c_str());
+          for (int index = _retainedFiles - 1; index >= 1; --index) {
+            std::rename(rotatedFilePath(index).c_str(), rotatedFilePath(index + 1).c_str());
+          }
+          std::rename(_path.c_str(), rotatedFilePath(1).c_str());
+        }
+        std::rename(nextFilePath().c_str(), _path.c_str()); // replaces the current file if none is retained
+      }
+    }
+
+    PreparedFile prepareFile() {
+      PreparedFile file;
+      file.fd = ::open(nextFilePath().c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+      if (file.fd < 0) {
+        return file;
+      }
+      file.chunk = mapChunk(file.fd, 0);
+      if (file.chunk.data == nullptr) {
+        ::close(file.fd);
+        ::unlink(nextFilePath().c_str());
+        file.fd = -1;
+      }
+      return file;
+    }
+
+//// Files
+    // Appends to the existing file, if any, after trimming the NUL bytes a crash may have left at
+    // its end. In the constructor, or under _mutex.
+    bool openCurrentFile() {
+      _fileOpenedAt = std::chrono::system_clock::now();
+      _fileFd = ::open(_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+      if (_fileFd < 0) {
+        return false;
+      }
+
+      struct stat status {};
+      ::fstat(_fileFd, &status);
+      const uint64_t size = contentSize(_fileFd, static_cast<uint64_t>(status.st_size));
+      const uint64_t chunkOffset = size / _chunkSize * _chunkSize;
+      Mapping chunk;
+      if (::ftruncate(_fileFd, static_cast<off_t>(size)) == 0) {
+        chunk = mapChunk(_fileFd, chunkOffset);
+      }
+      if (chunk.data == nullptr) {
+        ::close(_fileFd);
+        _fileFd = -1;
+        return false;
+      }
+      _fileWritten = size;
+      _nextChunkOffset = chunkOffset + _chunkSize;
+      useChunk(chunk);
+      return true;
+    }
+
+    // The size of the file without its trailing NUL bytes, which can span several chunks.
+    static uint64_t contentSize(const int fd, uint64_t size) {
+      std::vector<char> buffer(64 * 1024);
+      while (size > 0) {
+        const uint64_t start = size > buffer.size() ? size - buffer.size() : 0;
+        const auto count = static_cast<size_t>(size - start);
+        if (::pread(fd, buffer.data(), count, static_cast<off_t>(start)) != static_cast<ssize_t>(count)) {
+          return size; // keeps the rest as it is
+        }
+        for (size_t index = count; index > 0; --index) {
+          if (buffer[index - 1] != '\0') {
+            return start + index;
+          }
+        }
+        size = start;
+      }
+      return 0;
+    }
+
+    // Allocates the disk blocks (so that writing to the mapping can't fail) and maps them.
+    Mapping mapChunk(const int fd, const uint64_t offset) const {
+      if (!allocate(fd, offset, _chunkSize)) {
+        return {};
+      }
+      void* data = ::mmap(nullptr, _chunkSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, static_cast<off_t>(offset));
+      if (data == MAP_FAILED) {
+        return {};
+      }
+      return {static_cast<char*>(data), _chunkSize, offset};
+    }
+
+    static bool allocate(const int fd, const uint64_t offset, const size_t size) {
+#if defined(__APPLE__)
+      fstore_t store = {F_ALLOCATEALL, F_PEOFPOSMODE, 0, static_cast<off_t>(size), 0};
+      ::fcntl(fd, F_PREALLOCATE, &store); // best effort, there is no posix_fallocate
+      return ::ftruncate(fd, static_cast<off_t>(offset + size)) == 0;
+#else
+      return ::posix_fallocate(fd, static_cast<off_t>(offset), static_cast<off_t>(size)) == 0;
+#endif
+    }
+
+    static void unmap(Mapping& mapping) {
+      if (mapping.data != nullptr) {
+        ::munmap(mapping.data, mapping.size);
+        mapping = {};
+      }
+    }
+
+    static void closeFile(const int fd, const uint64_t size) {
+      if (fd >= 0) {
+        ::ftruncate(fd, static_cast<off_t>(size));
+        ::close(fd);
+      }
+    }
+
+    [[nodiscard]] std::string rotatedFilePath(const int index) const {
+      return _path + "." + std::to_string(index);
+    }
+
+    [[nodiscard]] std::string nextFilePath() const {
+      return _path + ".next";
+    }
+
+    static size_t roundToPageSize(const size_t size) {
+      const auto pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+      return size <= pageSize ? pageSize : (size + pageSize - 1) / pageSize * pageSize;
+    }
+  };
+
+} // namespace ulog
@@ -0,0 +1,335 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "log_level.h"
+#include "log_queue.h"
+#include "logs_observer.h"
+
+namespace ulog {
+
+  // Observers of a LoggerFactory's lines, each fed through its own bounded queue by its own
+  // delivery thread, so that a slow observer never slows down the logging threads: when its queue
+  // is full, it misses lines instead (counted by `droppedCount`).
+  //
+  // Publishing a line allocates a single LogRecord shared by all the observers whose minimum level
+  // it passes, and costs one relaxed load when there are no observers.
+  class ObserverRegistry {
+  public:
+    static constexpr size_t DEFAULT_QUEUE_CAPACITY = 4096;
+
+    ObserverRegistry() = default;
+
+    ObserverRegistry(const ObserverRegistry&) = delete;
+    ObserverRegistry& operator=(const ObserverRegistry&) = delete;
+
+    ~ObserverRegistry() {
+      std::lock_guard<std::mutex> lock(_updateMutex);
+      const auto channels = _channels.exchange(std::make_shared<const Channels>());
+      for (const auto& channel : *channels) {
+        close(channel);
+      }
+    }
+
+    void add(LogsObserver* observer, const LogLevel minLevel, const size_t queueCapacity) {
+      std::lock_guard<std::mutex> lock(_updateMutex);
+      auto channels = std::make_shared<Channels>(*_channels.load());
+      channels->push_back(std::make_shared<Channel>(observer, minLevel, queueCapacity));
+      _channels.store(std::shared_ptr<const Channels>(std::move(channels)));
+      _count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // The lines already queued for the observer are delivered first, and the observer isn't called
+    // once this returns. An observer can remove itself from its `onLogRecord`: its delivery thread
+    // then stops after the current call, and is joined by a background thread.
+    bool remove(LogsObserver* observer) {
+      std::shared_ptr<Channel> removed;
+      {
+        std::lock_guard<std::mutex> lock(_updateMutex);
+        auto channels = std::make_shared<Channels>(*_channels.load());
+        const auto found = std::find_if(channels->begin(), channels->end(), [&](const std::shared_ptr<Channel>& channel) {
+          return channel->observer() == observer;
+        });
+        if (found == channels->end()) {
+          return false;
+        }
+        removed = *found;
+        channels->erase(found);
+        _channels.store(std::shared_ptr<const Channels>(std::move(channels)));
+        _count.fetch_sub(1, std::memory_order_relaxed);
+      }
+      close(removed);
+      return true;
+    }
+
+    [[nodiscard]] bool empty() const {
+      return _count.load(std::memory_order_relaxed) == 0;
+    }
+
+    void publish(const std::string_view text, const LogLevel level) {
+      const auto channels = _channels.load();
+      LogRecord record;
+      for (const auto& channel : *channels) {
+        if (level < channel->minLevel()) {
+          continue;
+        }
+        if (record.text().empty()) {
+          record = LogRecord(text, level);
+        }
+        channel->offer(record);
+      }
+    }
+
+    // Blocks until the lines published so far have been delivered.
+    void flush() const {
+      for (const auto& channel : *_channels.load()) {
+        channel->flush();
+      }
+    }
+
+    // Lines the observer missed because its queue was full.
+    [[nodiscard]] uint64_t droppedCount(const LogsObserver* observer) const {
+      for (const auto& channel : *_channels.load()) {
+        if (channel->observer() == observer) {
+          return channel->droppedCount();
+        }
+      }
+      return 0;
+    }
+
+    // Lines missed by all the current observers.
+    [[nodiscard]] uint64_t droppedCount() const {
+      uint64_t dropped = 0;
+      for (const auto& channel : *_channels.load()) {
+        dropped += channel->droppedCount();
+      }
+      return dropped;
+    }
+
+  private:
+    class Channel;
+
+    // Stops a removed channel's delivery thread and waits for it, unless called from that thread
+    // (an observer removing itself), which the Reaper joins instead. Either way, whoever drops the
+    // last reference to the channel (possibly a logging thread, still holding the previous list of
+    // channels in `publish`) never waits for its thread.
+    static void close(const std::shared_ptr<Channel>& channel) {
+      channel->stop();
+      if (channel->isDeliveryThread()) {
+        Reaper::retire(channel);
+      } else {
+        channel->join();
+      }
+    }
+
+    class Channel {
+    public:
+      Channel(LogsObserver* observer, const LogLevel minLevel, const size_t queueCapacity)
+          : _observer(observer),
+            _minLevel(minLevel),
+            _queue(queueCapacity) {
+        _thread = std::thread(&Channel::run, this);
+      }
+
+      Channel(const Channel&) = delete;
+      Channel& operator=(const Channel&) = delete;
+
+      ~Channel() {
+        stop();
+        join(); // already joined by ObserverRegistry::close
+      }
+
+      // The delivery thread exits once the queued lines are delivered; lines offered afterwards
+      // are ignored.
+      void stop() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping.store(true, std::memory_order_relaxed);
+        _wakeCondition.notify_one();
+      }
+
+      void join() {
+        if (_thread.joinable()) {
+          _thread.join();
+        }
+      }
+
+      [[nodiscard]] bool isDeliveryThread() const {
+        return std::this_thread::get_id() == _thread.get_id();
+      }
+
+      void offer(const LogRecord& record) {
+        if (_stopping.load(std::memory_order_relaxed)) {
+          return;
+        }
+        if (!_queue.tryPush([&](LogRecord& slot) { slot = record; })) {
+          _dropped.fetch_add(1, std::memory_order_relaxed);
+          return;
+        }
+        _pushed.fetch_add(1, std::memory_order_seq_cst);
+        if (_sleeping.load(std::memory_order_seq_cst)) {
+          std::lock_guard<std::mutex> lock(_mutex);
+          _wakeCondition.notify_one();
+        }
+      }
+
+      void flush() {
+        const uint64_t target = _pushed.load(std::memory_order_acquire);
+        std::unique_lock<std::mutex> lock(_mutex);
+        _wakeCondition.notify_one();
+        _deliveredCondition.wait(lock, [&] { return _delivered.load(std::memory_order_acquire) >= target; });
+      }
+
+      [[nodiscard]] LogsObserver* observer() const {
+        return _observer;
+      }
+
+      [[nodiscard]] LogLevel minLevel() const {
+        return _minLevel;
+      }
+
+      [[nodiscard]] uint64_t droppedCount() const {
+        return _dropped.load(std::memory_order_relaxed);
+      }
+
+    private:
+      static constexpr auto IDLE_WAIT = std::chrono::milliseconds(100);
+
+      LogsObserver*             _observer;
+      LogLevel                  _minLevel;
+      BoundedLogQueue<LogRecord> _queue;
+      std::thread               _thread;
+
+      std::atomic<uint64_t>     _pushed{0};
+      std::atomic<uint64_t>     _delivered{0};
+      std::atomic<uint64_t>     _dropped{0};
+      std::atomic<bool>         _sleeping{false};
+      std::atomic<bool>         _stopping{false}; // set under _mutex
+
+      std::mutex                _mutex;
+      std::condition_variable   _wakeCondition;
+      std::condition_variable   _deliveredCondition;
+
+      void run() {
+        LogRecord record;
+        for (;;) {
+          uint64_t count = 0;
+          while (_queue.tryPop([&](LogRecord& slot) { record = std::move(slot); })) {
+            _observer->onLogRecord(record);
+            record = {};
+            ++count;
+          }
+          std::unique_lock<std::mutex> lock(_mutex);
+          if (count > 0) {
+            _delivered.fetch_add(count, std::memory_order_release);
+            _deliveredCondition.notify_all();
+            continue;
+          }
+          if (_stopping.load(std::memory_order_relaxed)) {
+            break;
+          }
+
+          // Either `offer` sees the flag, or we see its `_pushed` increment
+          _sleeping.store(true, std::memory_order_seq_cst);
+          if (_pushed.load(std::memory_order_seq_cst) == _delivered.load(std::memory_order_relaxed)) {
+            _wakeCondition.wait_for(lock, IDLE_WAIT);
+          }
+          _sleeping.store(false, std::memory_order_relaxed);
+        }
+      }
+    };
+
+    // Joins the delivery threads of the observers that removed themselves, which can't join
+    // themselves, then releases their channels. Started on the first such removal.
+    class Reaper {
+    public:
+      static void retire(std::shared_ptr<Channel> channel) {
+        static Reaper reaper;
+        std::lock_guard<std::mutex> lock(reaper._mutex);
+        reaper._retired.push_back(std::move(channel));
+        reaper._condition.notify_one();
+      }
+
+      Reaper() : _thread(&Reaper::run, this) {
+        // empty
+      }
+
+      ~Reaper() {
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          _stopping = true;
+          _condition.notify_one();
+        }
+        _thread.join();
+      }
+
+    private:
+      std::mutex                            _mutex;
+      std::condition_variable               _condition;
+      std::vector<std::shared_ptr<Channel>> _retired;  // under _mutex
+      bool                                  _stopping = false;
+      std::thread                           _thread;
+
+      void run() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (!_stopping || !_retired.empty()) {
+          _condition.wait(lock, [&] { return _stopping || !_retired.empty(); });
+          std::vector<std::shared_ptr<Channel>> retired;
+          retired.swap(_retired);
+          lock.unlock();
+          for (const auto& channel : retired) {
+            channel->join();
+          }
+          retired.clear();
+          lock.lock();
+        }
+      }
+    };
+
+    using Channels = std::vector<std::shared_ptr<Channel>>;
+
+    std::atomic<std::shared_ptr<const Channels>> _channels{std::make_shared<const Channels>()};
+    std::atomic<size_t>             _count{0};
+    std::mutex                      _updateMutex;  // serializes add/remove
+  };
+
+} // namespace ulog
@@ -0,0 +1,160 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono> // don't remove - needed with GCC -Werror
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <string>
+
+namespace ulog {
+
+  // Number of fractional digits after the seconds in a log line's timestamp.
+  enum TimestampPrecision {
+    MILLISECONDS = 3,
+    MICROSECONDS = 6,
+    NANOSECONDS  = 9
+  };
+
+  // Formats timestamps as "YYYY-mm-dd HH:MM:SS.fff" (local time).
+  //
+  // The calendar part only changes once per second, so each thread keeps the formatted
+  // "YYYY-mm-dd HH:MM:SS." prefix of the last second it saw and only patches in the fractional
+  // digits. The prefix is always computed with the local time of that exact second, so DST
+  // transitions (which happen on a second boundary) are handled like before. If the process changes
+  // its timezone at runtime (e.g. `setenv("TZ", ...)` + `tzset()`), call `invalidate()`.
+  class TimestampCache {
+  public:
+    static constexpr size_t MAX_FORMATTED_SIZE = 32;
+
+    // Writes the formatted timestamp to `out` (at least MAX_FORMATTED_SIZE bytes, not
+    // null-terminated) and returns its length.
+    static size_t format(
+      const std::chrono::system_clock::time_point now,
+      const TimestampPrecision precision,
+      char* out
+    ) {
+      const auto sinceEpoch = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch());
+      const auto seconds = std::chrono::floor<std::chrono::seconds>(sinceEpoch);
+      const auto nanoseconds = static_cast<uint32_t>((sinceEpoch - seconds).count());
+
+      Entry& entry = threadEntry();
+      const uint64_t generation = _generation.load(std::memory_order_relaxed);
+      if (entry.second != seconds.count() || entry.generation != generation) {
+        entry.second = seconds.count();
+        entry.generation = generation;
+        entry.prefixSize = formatPrefix(static_cast<std::time_t>(entry.second), entry.prefix);
+      }
+
+      std::memcpy(out, entry.prefix, entry.prefixSize);
+      writeFraction(nanoseconds, precision, out + entry.prefixSize);
+      return entry.prefixSize + precision;
+    }
+
+    static std::string format(
+      const std::chrono::system_clock::time_point now,
+      const TimestampPrecision precision = MILLISECONDS
+    ) {
+      char buffer[MAX_FORMATTED_SIZE];
+      return {buffer, format(now, precision, buffer)};
+    }
+
+    // Drops every thread's cached prefix, e.g. after the timezone has been changed.
+    static void invalidate() {
+      _generation.fetch_add(1, std::memory_order_relaxed);
+    }
+
+  private:
+    struct Entry {
+      int64_t  second = INT64_MIN;
+      uint64_t generation = 0;
+      char     prefix[MAX_FORMATTED_SIZE];
+      size_t   prefixSize = 0;
+    };
+
+    static inline std::atomic<uint64_t> _generation{0};
+
+    static Entry& threadEntry() {
+      thread_local Entry entry;
+      return entry;
+    }
+
+    // Writes "YYYY-mm-dd HH:MM:SS." (or "ERROR-TIME.") and returns its length.
+    static size_t formatPrefix(const std::time_t time, char* out) {
+      std::tm localTime;
+      size_t size = toLocalTime(time, localTime)
+        ? std::strftime(out, MAX_FORMATTED_SIZE - NANOSECONDS - 1, "%Y-%m-%d %H:%M:%S", &localTime)
+        : 0;
+      if (size == 0) {
+        static constexpr char ERROR_TIME[] = "ERROR-TIME";
+        size = sizeof(ERROR_TIME) - 1;
+        std::memcpy(out, ERROR_TIME, size);
+      }
+      out[size] = '.';
+      return size + 1;
+    }
+
+    static void writeFraction(uint32_t nanoseconds, const TimestampPrecision precision, char* out) {
+      for (int i = NANOSECONDS; i > precision; --i) {
+        nanoseconds /= 10;
+      }
+      for (int i = precision - 1; i >= 0; --i) {
+        out[i] = static_cast<char>('0' + nanoseconds % 10);
+        nanoseconds /= 10;
+      }
+    }
+
+    static bool toLocalTime(const std::time_t time, std::tm& result) {
+#if defined(_WIN32)
+      // Windows uses localtime_s
+      return localtime_s(&result, &time) == 0;
+#elif defined(_POSIX_C_SOURCE) || defined(_GNU_SOURCE)
+      // POSIX systems have localtime_r
+      return localtime_r(&time, &result) != nullptr;
+#else
+      // Fallback: use a static mutex to protect localtime
+      static std::mutex localtime_mutex;
+      std::lock_guard<std::mutex> lock(localtime_mutex);
+      const std::tm* temp = std::localtime(&time);
+      if (temp == nullptr) {
+        return false;
+      }
+      result = *temp;
+      return true;
+#endif
+    }
+  };
+
+} // namespace ulog
@@ -0,0 +1,133 @@
+/*******************************************************************************\
+
+micro-logger-cpp - Header-only C++ logging lib using streams
+
+https://github.com/raphael-isvelin/micro-logger-cpp
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (C) 2025 Raphaël Isvelin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#pragma once
+
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <ratio>
+#include <string_view>
+#include <type_traits>
+
+#include "log_buffer.h"
+
+namespace ulog {
+
+  // Writes values straight into a LogBuffer with std::to_chars, skipping std::ostream's sentry,
+  // locale and virtual calls. The output is the same as std::ostream's with its default formatting
+  // state (e.g. 6 significant digits for floating point values, "0" for a null pointer).
+  class ValueFormatter {
+  public:
+    // Largest output of any of the numeric functions below
+    static constexpr size_t MAX_NUMBER_SIZE = 64;
+
+    template <typename T>
+    static constexpr bool isCharacter =
+      std::is_same_v<T, char> || std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char>
+      || std::is_same_v<T, wchar_t> || std::is_same_v<T, char8_t>
+      || std::is_same_v<T, char16_t> || std::is_same_v<T, char32_t>;
+
+    template <typename T>
+    static constexpr bool isInteger = std::is_integral_v<T> && !std::is_same_v<T, bool> && !isCharacter<T>;
+
+    template <typename T>
+    static void appendInteger(LogBuffer& buffer, const T value) {
+      char* begin = buffer.reserve(MAX_NUMBER_SIZE);
+      buffer.commit(static_cast<size_t>(std::to_chars(begin, begin + MAX_NUMBER_SIZE, value).ptr - begin));
+    }
+
+    template <typename T>
+    static void appendFloatingPoint(LogBuffer& buffer, const T value) {
+      char* begin = buffer.reserve(MAX_NUMBER_SIZE);
+      const auto result = std::to_chars(
+        begin, begin + MAX_NUMBER_SIZE, value, std::chars_format::general, DEFAULT_PRECISION
+      );
+      buffer.commit(static_cast<size_t>(result.ptr - begin));
+    }
+
+    static void appendBool(LogBuffer& buffer, const bool value) {
+      buffer.append(value ? '1' : '0');
+    }
+
+    static void appendPointer(LogBuffer& buffer, const void* value) {
+      if (value == nullptr) {
+        buffer.append('0');
+        return;
+      }
+      char* begin = buffer.reserve(MAX_NUMBER_SIZE);
+      begin[0] = '0';
+      begin[1] = 'x';
+      const auto address = reinterpret_cast<std::uintptr_t>(value);
+      const auto end = std::to_chars(begin + 2, begin + MAX_NUMBER_SIZE, address, 16).ptr;
+      buffer.commit(static_cast<size_t>(end - begin));
+    }
+
+    // e.g. "150ms", "3min", "12[1/30]s" (same suffixes as C++20, with "us" for microseconds)
+    template <typename Rep, typename Period>
+    static void appendDuration(LogBuffer& buffer, const std::chrono::duration<Rep, Period> value) {
+      if constexpr (std::is_floating_point_v<Rep>) {
+        appendFloatingPoint(buffer, value.count());
+      } else {
+        appendInteger(buffer, value.count());
+      }
+
+      if constexpr (std::is_same_v<Period, std::nano>) {
+        buffer.append(std::string_view("ns"));
+      } else if constexpr (std::is_same_v<Period, std::micro>) {
+        buffer.append(std::string_view("us"));
+      } else if constexpr (std::is_same_v<Period, std::milli>) {
+        buffer.append(std::string_view("ms"));
+      } else if constexpr (std::is_same_v<Period, std::ratio<1>>) {
+        buffer.append('s');
+      } else if constexpr (std::is_same_v<Period, std::ratio<60>>) {
+        buffer.append(std::string_view("min"));
+      } else if constexpr (std::is_same_v<Period, std::ratio<3600>>) {
+        buffer.append('h');
+      } else if constexpr (std::is_same_v<Period, std::ratio<86400>>) {
+        buffer.append('d');
+      } else {
+        buffer.append('[');
+        appendInteger(buffer, Period::num);
+        if constexpr (Period::den != 1) {
+          buffer.append('/');
+          appendInteger(buffer, Period::den);
+        }
+        buffer.append(std::string_view("]s"));
+      }
+    }
+
+  private:
+    static constexpr int DEFAULT_PRECISION = 6; // std::ostream's default
+  };
+
+} // namespace ulog
@@ -0,0 +1,48 @@
+// Decodes binary logs (LoggerFactory::binaryMode) into the usual text lines.
+//
+// Usage: ulog_decode [file...]   (reads stdin if no file is given; writes to stdout)
+// Timestamps are converted to the local timezone of this process, e.g. `TZ=UTC ulog_decode app.blog`.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+#include <micro-logger/binary_log.h>
+
+static bool decode(std::istream& input, const char* name) {
+  ulog::BinaryLogDecoder decoder;
+  bool valid = true;
+  char chunk[64 * 1024];
+  while (input.read(chunk, sizeof(chunk)) || input.gcount() > 0) {
+    valid &= decoder.decode(std::string_view(chunk, static_cast<size_t>(input.gcount())), [](const std::string_view line) {
+      std::cout.write(line.data(), static_cast<std::streamsize>(line.size()));
+    });
+  }
+  if (!valid) {
+    std::cerr << "ulog_decode: " << name << ": skipped corrupted records" << std::endl;
+  }
+  if (decoder.pending()) {
+    std::cerr << "ulog_decode: " << name << ": truncated last record" << std::endl;
+  }
+  return valid;
+}
+
+int main(const int argc, char** argv) {
+  std::ios::sync_with_stdio(false);
+  if (argc < 2) {
+    return decode(std::cin, "<stdin>") ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  bool valid = true;
+  for (int i = 1; i < argc; ++i) {
+    std::ifstream file(argv[i], std::ios::in | std::ios::binary);
+    if (!file) {
+      std::cerr << "ulog_decode: " << argv[i] << ": cannot open" << std::endl;
+      valid = false;
+      continue;
+    }
+    valid &= decode(file, argv[i]);
+  }
+  return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+}